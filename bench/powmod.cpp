@@ -0,0 +1,98 @@
+/**
+ * @brief Benchmark of modular exponentiation: Montgomery against Barrett
+ * against a naive (a * b) % m square-and-multiply loop on int2048.
+ * The modulus, base and exponent all have the same number of digits,
+ * and the modulus is coprime to 10, so that both reductions apply.
+ * powmod() switches from Montgomery to Barrett at Max_Brute_Mul_Length
+ * words (512 digits), which the default sizes are chosen around.
+ *
+ * Build and run:
+ *  g++ -std=c++20 -O2 -I../src powmod.cpp -o powmod -pthread
+ *  ./powmod [digits...]
+ */
+#include "int2048"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using dark::int2048;
+
+namespace {
+
+std::mt19937_64 gen {2048};
+
+/* Random number of __n decimal digits, without leading 0. */
+std::string random_digits(std::size_t __n) {
+    std::string __str;
+    __str.push_back('1' + gen() % 9);
+    while (__str.size() < __n) __str.push_back('0' + gen() % 10);
+    return __str;
+}
+
+/* Right-to-left binary exponentiation with the plain operators only. */
+int2048 naive_powmod(int2048 __base, int2048 __exp, const int2048 &__mod) {
+    int2048 __ret {std::intmax_t {1}};
+    __ret  %= __mod;
+    __base %= __mod;
+    while (__exp.is_non_zero()) {
+        if (__exp % 2 == 1) __ret = __ret * __base % __mod;
+        __base = __base * __base % __mod;
+        __exp /= 2;
+    } return __ret;
+}
+
+/* Best time of a few runs in milliseconds, with the result of the last. */
+template <typename _Func>
+double best_of(std::size_t __runs, int2048 &__out, _Func &&__func) {
+    double __best = 1e300;
+    while (__runs--) {
+        const auto __beg = std::chrono::steady_clock::now();
+        __out = __func();
+        const auto __end = std::chrono::steady_clock::now();
+        __best = std::min(__best, std::chrono::duration <double, std::milli> (__end - __beg).count());
+    } return __best;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector <std::size_t> __sizes {40, 200, 400, 480, 504, 520, 560, 640, 800};
+    if (argc > 1) {
+        __sizes.clear();
+        for (int i = 1 ; i < argc ; ++i) __sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+
+    std::cout << " digits  words    montgomery       barrett         naive  powmod uses\n";
+    for (const std::size_t __n : __sizes) {
+        if (__n < 2) continue;
+        const int2048 __mod  {random_digits(__n - 1) + "7"};
+        const int2048 __base {random_digits(__n)};
+        const int2048 __exp  {random_digits(__n)};
+        const std::size_t __runs = __n <= 200 ? 5 : 2;
+
+        int2048 __r0, __r1, __r2;
+        const double __t0 = best_of(__runs, __r0, [&] {
+            return dark::montgomery_context {__mod}.pow(__base, __exp);
+        });
+        const double __t1 = best_of(__runs, __r1, [&] {
+            return dark::barrett_reducer {__mod}.pow(__base, __exp);
+        });
+        const double __t2 = best_of(1, __r2, [&] {
+            return naive_powmod(__base, __exp, __mod);
+        });
+
+        if (!(__r0 == __r2 && __r1 == __r2)) {
+            std::cerr << "mismatch at " << __n << " digits\n";
+            return 1;
+        }
+
+        const std::size_t __words = (__n + 7) / 8;
+        std::printf("%7zu %6zu %10.3f ms %10.3f ms %10.3f ms  %s\n",
+            __n, __words, __t0, __t1, __t2, __words < 64 ? "montgomery" : "barrett");
+    }
+    return 0;
+}
@@ -1,20 +1,32 @@
 #pragma once
 
 #include "utility.h"
+#include "parallel.h"
 #include <limits>
+#include <atomic>
 #include <complex>
 #include <cstring>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 /* Some declarations. */
 namespace dark {
 
 struct int2048;
 struct int2048_view;
+template <std::size_t>
 struct uint2048;
 struct uint2048_view;
 struct int2048_base;
+struct prepared_multiplier;
+struct barrett_reducer;
+struct montgomery_context;
 
 } // namespace dark
 
@@ -24,56 +36,159 @@ struct FFT_base {
   protected:
     /* Maximum bit length of FFT. */
     inline static constexpr std::size_t FFT_Max = 20;
+    /* FFT longer than 2^FFT_Block will be split to fit in cache. */
+    inline static constexpr std::size_t FFT_Block = 12;
 
     using complex       = std::complex <double>;
     using _Word_Type    = std::uintmax_t;
-    /* Container for FFT operation. */
-    using FFT_t         = int2048_helper::vector <complex>;
-    /* Table reference for FFT operation. */
+    /* Scratch array for FFT operation. */
+    using FFT_t         = int2048_helper::scratch <complex>;
+    /* Twiddle factors for FFT operation. */
+    using plan_t        = struct _FFT_Plan {
+        const complex * root; // Root of order 2h is stored in [h, 2h).
+        const complex * half; // Roots for product_FFT, in bit-reversed order.
+    };
+    /* Twiddle factors for the radix-3 or radix-5 level, where w^t is stored at [t]. */
+    using mixed_t       = const complex *;
+    /* Twiddle factors up to some length, never modified once published. */
     using table_t       = struct _FFT_Table {
-        complex *   data; // Unit root table.
-        std::size_t bits; // Log2 of table size.
+        std::size_t                 size;   // Length the table is built for.
+        const _FFT_Table *          prev;   // Shorter table, kept for its readers.
+        int2048_helper::vector <complex> data;
+    };
+    /* Grow-only set of tables shared by all threads, where the longest is used. */
+    struct table_cache {
+        std::mutex                      lock;
+        std::atomic <const table_t *>   head {};
+        ~table_cache() noexcept;
+        template <typename _Func>
+        const table_t *get(std::size_t, _Func &&);
     };
+    /* Cost of the radix-3 and radix-5 level, in levels of radix-2. */
+    inline static constexpr double FFT_Radix_Cost[2] = {2.0, 3.0};
 
     /* FFT Zipping times. */
     inline static constexpr std::size_t FFT_Zip     = 2;
-    /* FFT Base Length. */
+    /* FFT Base Length, which is also the default digits per point (see FFT_digits). */
     inline static constexpr std::size_t FFT_BaseLen = 4;
     /* FFT Base Word. */
     inline static constexpr _Word_Type  FFT_Base    = int2048_helper::__pow(10U, FFT_BaseLen);
 
-    static void FFT(complex *, std::size_t) noexcept;
+    static void FFT(complex *, const complex *, std::size_t) noexcept;
+    static void IFFT(complex *, const complex *, std::size_t) noexcept;
+    static void FFT_level(complex *, const complex *, std::size_t, std::size_t, std::size_t) noexcept;
+    static void IFFT_level(complex *, const complex *, std::size_t, std::size_t, std::size_t) noexcept;
+    static void parallel_FFT(complex *, const complex *, std::size_t) noexcept;
+    static void parallel_IFFT(complex *, const complex *, std::size_t) noexcept;
+    [[__gnu__::__always_inline__]]
+    static inline complex cmul(complex, complex) noexcept;
+    [[__gnu__::__always_inline__]]
+    static inline std::int64_t FFT_round(double) noexcept;
+#if defined(__AVX2__)
+    /* 4 complex numbers, with the real and imaginary parts split. */
+    struct vcomplex {
+        __m256d re;
+        __m256d im;
+        friend vcomplex operator + (vcomplex __x, vcomplex __y) noexcept
+        { return { _mm256_add_pd(__x.re, __y.re), _mm256_add_pd(__x.im, __y.im) }; }
+        friend vcomplex operator - (vcomplex __x, vcomplex __y) noexcept
+        { return { _mm256_sub_pd(__x.re, __y.re), _mm256_sub_pd(__x.im, __y.im) }; }
+    };
+    /* A block of FFT within cache, with the real and imaginary parts in separate arrays. */
+    struct split_t {
+        alignas(32) double re[std::size_t {1} << FFT_Block];
+        alignas(32) double im[std::size_t {1} << FFT_Block];
+        void load(const complex *, std::size_t) noexcept;
+        void store(complex *, std::size_t) const noexcept;
+        vcomplex get(std::size_t __pos) const noexcept
+        { return { _mm256_load_pd(re + __pos), _mm256_load_pd(im + __pos) }; }
+        void set(std::size_t __pos, vcomplex __val) noexcept
+        { _mm256_store_pd(re + __pos, __val.re), _mm256_store_pd(im + __pos, __val.im); }
+    };
     [[__gnu__::__always_inline__]]
-    static inline void merge_FFT(complex *, complex *) noexcept;
+    static inline vcomplex split_root(const complex *) noexcept;
     [[__gnu__::__always_inline__]]
-    static inline void final_FFT(complex *, complex *) noexcept;
+    static inline vcomplex cmul(vcomplex, vcomplex) noexcept;
     [[__gnu__::__always_inline__]]
-    static inline void FFT_pass(FFT_t &) noexcept;
+    static inline vcomplex cmul_conj(vcomplex, vcomplex) noexcept;
+    static std::size_t FFT_split(complex *, const complex *, std::size_t) noexcept;
+    static void IFFT_split(complex *, const complex *, std::size_t, std::size_t) noexcept;
+#endif
+    [[__gnu__::__always_inline__]]
+    static inline void product_pair(complex *, const complex *, std::size_t, std::size_t,
+                                    complex, complex, double) noexcept;
+    static inline void product_FFT(complex *, const complex *, const complex *,
+                                   std::size_t, std::size_t, std::size_t) noexcept;
+    static inline void FFT_mul_pass(complex *, complex *, std::size_t, bool);
+    static inline void FFT_sqr_pass(FFT_t &, bool);
+
+    template <std::size_t _Radix, bool _Inverse>
+    static void FFT_radix(complex *, mixed_t, std::size_t, std::size_t, std::size_t) noexcept;
+    template <bool _Inverse>
+    static void mixed_level(complex *, std::size_t, std::size_t, bool);
+    static void mixed_FFT(complex *, std::size_t, bool);
+    static void mixed_IFFT(complex *, std::size_t, bool);
+    static std::size_t FFT_length(std::size_t) noexcept;
+
+    static plan_t make_plan(std::size_t);
+    static mixed_t make_mixed(std::size_t, std::size_t);
+};
 
-    static table_t make_table(std::size_t);
+struct NTT_base {
+  protected:
+    /* Maximum bit length of NTT. (Limited by the primes below.) */
+    inline static constexpr std::size_t NTT_Max = 26;
+
+    using _Mod_Type     = std::uint32_t;
+    /* Scratch array for NTT operation. */
+    using NTT_t         = int2048_helper::scratch <_Mod_Type>;
+
+    /* Modular arithmetic under a NTT-friendly prime. */
+    template <_Mod_Type _Mod, _Mod_Type _Root>
+    struct modular;
+
+    /* Three primes of form k * 2^n + 1, in ascending order. */
+    using NTT_Mod0      = modular < 469762049,  3>;
+    using NTT_Mod1      = modular <1811939329, 13>;
+    using NTT_Mod2      = modular <2013265921, 31>;
+
+    template <typename _Mod>
+    static void NTT(_Mod_Type *, const _Mod_Type *, std::size_t) noexcept;
+    template <typename _Mod>
+    static void INTT(_Mod_Type *, const _Mod_Type *, std::size_t) noexcept;
+    template <typename _Mod>
+    static void NTT_level(_Mod_Type *, const _Mod_Type *, std::size_t, std::size_t, std::size_t) noexcept;
+    template <typename _Mod>
+    static void INTT_level(_Mod_Type *, const _Mod_Type *, std::size_t, std::size_t, std::size_t) noexcept;
+    template <typename _Mod>
+    static void parallel_NTT(_Mod_Type *, const _Mod_Type *, std::size_t) noexcept;
+    template <typename _Mod>
+    static void parallel_INTT(_Mod_Type *, const _Mod_Type *, std::size_t) noexcept;
+    template <typename _Mod>
+    static void make_root(_Mod_Type *, std::size_t, bool, bool) noexcept;
 };
 
 /**
  * @brief Base class for int2048.
  * 
  */
-struct int2048_base : protected FFT_base {
+struct int2048_base : protected FFT_base, protected NTT_base {
   public:
     /**
      * A common buffer for iostream operations only.
      * Users may perform anything they want on it.
      * It just works as a flexible space for better performance.
+     * Each thread has its own buffer, so threads never share it.
      * 
      * Here is one example of how users may use this buffer:
      * 1. Call ::to_string(int2048_base::buffer) of an integer
      * to print out the same integer for multiple times.
      * 
      */
-    inline static std::string buffer {};
+    inline static thread_local std::string buffer {};
   protected:
 
     using _Word_Type = std::uintmax_t;
-    using _Container = int2048_helper::vector <_Word_Type>;
 
     /* Base of one word. */
     inline static constexpr _Word_Type  Base = int2048_helper::__pow(FFT_Base, FFT_Zip);
@@ -83,13 +198,38 @@ struct int2048_base : protected FFT_base {
     inline static constexpr std::size_t Init_Sizeof = 64;
     /* Init the array with this minimum size. */
     inline static constexpr std::size_t Init_Length = Init_Sizeof / sizeof(_Word_Type);
+    /* Container of words, where the first Init_Length words are kept inline. */
+    using _Container = int2048_helper::vector <_Word_Type, Init_Length>;
+    /* Scratch words for temporaries, borrowed from the arena of the thread. */
+    using _Scratch   = int2048_helper::scratch <_Word_Type>;
     /* Maximum indexs a builtin-in Word_Type may takes. */
     inline static constexpr std::size_t Word_Length =
         std::numeric_limits <_Word_Type>::digits10 / Base_Length + 1;
     /* Maximum length of brute force multiplication. */
-    inline static constexpr std::size_t Max_Brute_Mul_Length = 256;
-    /* Maximum length of brute force division and mod. */
-    inline static constexpr std::size_t Max_Brute_Div_Length = 1;
+    inline static constexpr std::size_t Max_Brute_Mul_Length = 64;
+    /* Maximum length of Karatsuba multiplication. Longer ones use Toom-3. */
+    inline static constexpr std::size_t Max_Karatsuba_Mul_Length = 256;
+    /* Maximum length of Toom-Cook multiplication. Longer ones use FFT. */
+    inline static constexpr std::size_t Max_Toom3_Mul_Length = 320;
+    /* Maximum length of FFT multiplication. Longer ones use NTT. */
+    inline static constexpr std::size_t Max_FFT_Mul_Length = std::size_t {1} << (FFT_Max - 1);
+    /* Minimum ratio of lengths to cut the longer one into blocks. */
+    inline static constexpr std::size_t Min_Slice_Mul_Ratio = 4;
+    /* Range of decimal digits packed into one point of FFT. */
+    inline static constexpr std::size_t Min_FFT_Digits = 3;
+    inline static constexpr std::size_t Max_FFT_Digits = 6;
+    /* Maximum distance from an integer allowed in the results of FFT. */
+    inline static constexpr double Max_FFT_Error = 0.25;
+    /* Default minimum length of multiplication to run in parallel. */
+    inline static constexpr std::size_t Min_Parallel_Mul_Length = std::size_t {1} << 16;
+    /* Maximum length of divisor in brute force division and mod. */
+    inline static constexpr std::size_t Max_Brute_Div_Length = 40;
+    /* Minimum ratio of lengths to divide the longer one block by block. */
+    inline static constexpr std::size_t Min_Block_Div_Ratio = 3;
+    /* Maximum length of divisor in recursive block division. Longer ones use newton method. */
+    inline static constexpr std::size_t Max_Block_Div_Length = 640;
+    /* Maximum length of FFT multiplication in use, set by set_ntt_threshold(). */
+    inline static std::size_t fft_mul_limit = Max_FFT_Mul_Length;
 
   protected:
     using _Iterator = typename _Container::iterator;
@@ -105,6 +245,11 @@ struct int2048_base : protected FFT_base {
         std::size_t length; /* Length of the different. */
         cmp_result_t cmp;   /* Compare result.          */
     };
+    using rcp_t = struct _Rcp_Type {
+        _Word_Type  divisor;    /* Divisor shifted to the highest bit.      */
+        _Word_Type  inverse;    /* floor((2^128 - 1) / divisor) - 2^64.     */
+        int         shift;      /* Number of bits the divisor is shifted.   */
+    };
     using add_t = bool;
     using sub_t = _Iterator;
     using mul_t = _Iterator;
@@ -119,27 +264,91 @@ struct int2048_base : protected FFT_base {
     static add_t add(_Iterator, uint2048_view, uint2048_view) noexcept;
     static sub_t sub(_Iterator, uint2048_view, uint2048_view) noexcept;
     static mul_t mul(_Iterator, uint2048_view, uint2048_view);
+    static mul_t sqr(_Iterator, uint2048_view);
     static div_t div(_Iterator, uint2048_view, uint2048_view);
     static mod_t mod(_Iterator, uint2048_view, uint2048_view);
-
-    static inv_t inv(_Iterator, uint2048_view) noexcept;
+    static std::pair <_Iterator, _Iterator>
+    divmod(_Iterator, _Iterator, uint2048_view, uint2048_view);
+
+    static inv_t inv(_Iterator, uint2048_view);
+    static _Word_Type inv_word(_Word_Type) noexcept;
+    static void inv_mod(_Iterator, uint2048_view, std::size_t);
+    static div_t exact_div(_Iterator, uint2048_view, uint2048_view);
+    static void brute_exact_div(_Iterator, uint2048_view, uint2048_view, std::size_t) noexcept;
+
+    static add_t add_in(_Iterator, std::size_t, uint2048_view) noexcept;
+    static dec_t sub_in(_Iterator, std::size_t, uint2048_view) noexcept;
+    static _Word_Type mul_small(_Iterator, uint2048_view, _Word_Type) noexcept;
+    static _Word_Type div_small(_Iterator, uint2048_view, _Word_Type) noexcept;
+    static _Word_Type mod_small(uint2048_view, _Word_Type) noexcept;
+
+    static rcp_t make_rcp(_Word_Type) noexcept;
+    [[__gnu__::__always_inline__]]
+    static inline _Word_Type div_rcp(_Word_Type &, _Word_Type, _Word_Type, const rcp_t &) noexcept;
 
   protected:
 
     static bool use_brute_mul(uint2048_view&, uint2048_view&) noexcept;
+    static bool is_same(uint2048_view, uint2048_view) noexcept;
+    static bool use_slice_mul(uint2048_view, uint2048_view) noexcept;
     static bool use_brute_div(uint2048_view&, uint2048_view&) noexcept;
-    static bool use_brute_mod(uint2048_view&, uint2048_view&);
 
     static mul_t brute_mul(_Iterator, uint2048_view, uint2048_view) noexcept;
+    static mul_t brute_sqr(_Iterator, uint2048_view) noexcept;
     static div_t brute_div(_Iterator, uint2048_view, uint2048_view);
-    static mod_t brute_mod(_Iterator, uint2048_view, uint2048_view) noexcept;
-
-    static FFT_t make_FFT(uint2048_view, uint2048_view);
-
-    static uint2048_view try_div(_Iterator, uint2048_view, uint2048_view) noexcept;
-
-    static div_t adjust_div(_Iterator,_Iterator,uint2048_view,uint2048_view,uint2048_view) noexcept;
-    static mod_t adjust_mod(_Iterator,_Iterator,uint2048_view,uint2048_view,uint2048_view) noexcept;
+    static mod_t brute_mod(_Iterator, uint2048_view, uint2048_view);
+    static std::pair <_Iterator, _Iterator>
+    brute_divmod(_Iterator, _Iterator, uint2048_view, uint2048_view);
+    static void knuth_pass(_Iterator, _Iterator, std::size_t, uint2048_view) noexcept;
+    static std::pair <_Iterator, _Word_Type>
+    knuth_div(_Iterator, _Scratch &, uint2048_view, uint2048_view);
+
+    static mul_t tier_mul(_Iterator, uint2048_view, uint2048_view);
+    static void tier_pass(_Iterator, uint2048_view, uint2048_view, _Iterator) noexcept;
+    static void karatsuba_pass(_Iterator, uint2048_view, uint2048_view, _Iterator) noexcept;
+    static void toom3_pass(_Iterator, uint2048_view, uint2048_view, _Iterator) noexcept;
+    static std::size_t tier_space(std::size_t, std::size_t) noexcept;
+
+    static std::size_t FFT_digits(std::size_t, std::size_t) noexcept;
+    static std::size_t FFT_points(std::size_t, std::size_t) noexcept;
+    template <typename _Func>
+    static decltype(auto) FFT_visit(std::size_t, _Func &&);
+    template <std::size_t _Digits, typename _Func>
+    static void split_digits(uint2048_view, _Func &&);
+    template <std::size_t _Digits, typename _Func>
+    static std::pair <_Word_Type, _Word_Type> merge_digits(std::size_t, _Func &&);
+
+    static mul_t fft_mul(_Iterator, uint2048_view, uint2048_view);
+    static bool FFT_guard(const complex *, std::size_t, bool);
+    static void load_FFT(complex *, uint2048_view, std::size_t, std::size_t) noexcept;
+    static void unload_FFT(_Iterator, const complex *, std::size_t, std::size_t, std::size_t, bool);
+    static mul_t fft_sqr(_Iterator, uint2048_view);
+    static mul_t slice_mul(_Iterator, uint2048_view, uint2048_view);
+
+    static mul_t ntt_mul(_Iterator, uint2048_view, uint2048_view);
+    template <typename _Mod>
+    static void NTT_pass(NTT_t &, NTT_t &, uint2048_view, uint2048_view, bool);
+
+    template <typename _Func>
+    static _Word_Type carry_pass(_Iterator, std::size_t, bool, _Func &&);
+
+    static bool use_block_div(uint2048_view, uint2048_view) noexcept;
+    static std::pair <_Iterator, _Iterator>
+    block_div(_Iterator, _Iterator, uint2048_view, uint2048_view);
+    static _Iterator block_pass(_Iterator, _Iterator, uint2048_view, uint2048_view, std::size_t);
+
+    static uint2048_view try_div(_Scratch &, uint2048_view, uint2048_view);
+    static void inv_pass(_Iterator, uint2048_view);
+
+    static std::pair <_Iterator, std::ptrdiff_t>
+    adjust_pass(_Iterator, uint2048_view, uint2048_view, uint2048_view);
+    static div_t adjust_div(_Iterator, uint2048_view, uint2048_view, uint2048_view);
+    static mod_t adjust_mod(_Iterator, uint2048_view, uint2048_view, uint2048_view);
+    static std::pair <_Iterator, _Iterator>
+    adjust_divmod(_Iterator, _Iterator, uint2048_view, uint2048_view, uint2048_view);
+
+    template <typename _Reducer>
+    static int2048 pow_window(const _Reducer &, int2048_view, int2048_view);
 
   protected:
 
@@ -162,8 +371,24 @@ struct int2048_base : protected FFT_base {
     static _Iterator init_value(_Iterator, _Word_Type) noexcept;
 
   public:
-    /* Return the maximum possible length of the integer in decimal. */
-    static consteval std::size_t max_digits() noexcept { return FFT_BaseLen << (FFT_Max - 1); }
+    /**
+     * @brief Run large multiplications with __n threads (including the caller).
+     * Only those with at least __min words in the result are run in parallel.
+     * @param __n Number of threads. 0 or 1 means single-threaded (by default).
+     * @note This should not be called during any multiplication.
+     */
+    static void set_threads(std::size_t __n, std::size_t __min = Min_Parallel_Mul_Length);
+    /**
+     * @brief Multiply by NTT instead of FFT once the result has more than __n words.
+     * @param __n Maximum length of FFT multiplication. It is clamped to
+     * Max_FFT_Mul_Length (by default), where FFT runs out of precision.
+     * @note Shorter products still use brute force, Karatsuba and Toom-3.
+     * This should not be called during any multiplication.
+     */
+    static void set_ntt_threshold(std::size_t __n = Max_FFT_Mul_Length) noexcept;
+
+    /* Return the maximum possible length of the integer in decimal. (Only limited by memory.) */
+    static consteval std::size_t max_digits() noexcept { return std::numeric_limits <std::size_t>::max(); }
 };
 
 /**
@@ -176,7 +401,11 @@ struct uint2048_view : int2048_base {
     friend class int2048_base;
     friend class int2048_view;
     friend class int2048;
-    friend class uint2048;
+    template <std::size_t>
+    friend struct uint2048;
+    friend class prepared_multiplier;
+    friend class barrett_reducer;
+    friend class montgomery_context;
 
     using _Base_Type = int2048_base;
     using _Base_Type::_Word_Type;
@@ -199,7 +428,8 @@ struct uint2048_view : int2048_base {
 
     explicit uint2048_view(const int2048 &) noexcept;
     // explicit uint2048_view(const int2048 &&) = delete;
-    uint2048_view(const uint2048 &) noexcept;
+    template <std::size_t _Len>
+    uint2048_view(const uint2048 <_Len> &) noexcept;
     // uint2048_view(const uint2048 &&) = delete;
 
     explicit uint2048_view(int2048_view) noexcept;
@@ -235,7 +465,11 @@ struct int2048_view : int2048_base {
   protected:
     friend class uint2048_view;
     friend class int2048;
-    friend class uint2048;
+    template <std::size_t>
+    friend struct uint2048;
+    friend class prepared_multiplier;
+    friend class barrett_reducer;
+    friend class montgomery_context;
 
     using _Base_Type = int2048_base;
     using _Base_Type::_Word_Type;
@@ -258,7 +492,8 @@ struct int2048_view : int2048_base {
 
     int2048_view(const int2048 &) noexcept;
     // int2048_view(const int2048 &&) = delete;
-    explicit int2048_view(const uint2048 &) noexcept;
+    template <std::size_t _Len>
+    explicit int2048_view(const uint2048 <_Len> &) noexcept;
     // explicit int2048_view(const uint2048 &&) = delete;
 
     explicit int2048_view(uint2048_view) noexcept;
@@ -283,6 +518,7 @@ struct int2048_view : int2048_base {
     friend int2048 operator + (int2048_view, int2048_view);
     friend int2048 operator - (int2048_view, int2048_view);
     friend int2048 operator * (int2048_view, int2048_view);
+    friend int2048 sqr(int2048_view);
 
     friend int2048 &operator += (int2048 &lhs, int2048_view rhs);
     friend int2048 &operator *= (int2048 &lhs, int2048_view rhs);
@@ -323,6 +559,9 @@ struct int2048 : int2048_base {
 
     friend class int2048_view;
     friend class uint2048_view;
+    friend class prepared_multiplier;
+    friend class barrett_reducer;
+    friend class montgomery_context;
 
     using _Base_Type = int2048_base;
     using _Base_Type::_Word_Type;
@@ -338,6 +577,9 @@ struct int2048 : int2048_base {
     _Iterator begin() noexcept { return data.begin(); }
     _Iterator end()   noexcept { return data.end(); }
 
+    void divmod_pass(int2048_view, int2048 &);
+    void div_pass(int2048_view, int2048_view);
+
   public:
     /* Constructors and assignements. */
 
@@ -399,11 +641,35 @@ struct int2048 : int2048_base {
     friend int2048 operator * (int2048 &&, int2048_view);
     friend int2048 operator * (int2048 &&, int2048 &&);
 
+    friend int2048 sqr(int2048_view);
+
     int2048 &operator /= (const int2048 &);
-    friend int2048 operator / (int2048, const int2048 &);
+    friend int2048 operator / (int2048_view, const int2048 &);
+    friend int2048 operator / (int2048 &&, const int2048 &);
 
     int2048 &operator %= (const int2048 &);
-    friend int2048 operator % (int2048, const int2048 &);
+    friend int2048 operator % (int2048_view, const int2048 &);
+    friend int2048 operator % (int2048 &&, const int2048 &);
+
+    int2048 divmod(const int2048 &) &;
+    int2048 &divmod(const int2048 &, int2048 &) &;
+    friend std::pair <int2048, int2048> divmod(int2048_view, int2048_view);
+    friend int2048 divexact(int2048_view, int2048_view);
+
+    template <std::integral _Tp>
+    _Tp divmod(_Tp) &;
+
+    template <std::integral _Tp>
+    int2048 &operator /= (_Tp);
+    template <std::integral _Tp>
+    friend int2048 operator / (int2048, _Tp);
+
+    template <std::integral _Tp>
+    int2048 &operator %= (_Tp);
+    template <std::integral _Tp>
+    friend _Tp operator % (int2048_view, _Tp);
+    template <std::integral _Tp>
+    friend _Tp operator % (const int2048 &, _Tp);
 
     friend std::istream &operator >> (std::istream &, int2048 &);
 
@@ -425,6 +691,9 @@ struct int2048 : int2048_base {
     int2048 &negate() & noexcept;
     int2048 negate() && noexcept;
 
+    int2048 &square() &;
+    int2048 square() &&;
+
     std::size_t digits() const noexcept;
 
     void read(std::istream & = std::cin);
@@ -517,6 +786,217 @@ struct int2048 : int2048_base {
 
 };
 
+/**
+ * @brief Unsigned integer of at most _Len words, which are stored
+ * inline. It never allocates and is trivially copyable, and its
+ * arithmetic is done by the kernels of int2048_base through views.
+ * @note Results longer than _Len words are taken modulo Base^_Len,
+ * except that subtraction should never go below 0.
+ */
+template <std::size_t _Len>
+struct uint2048 : int2048_base {
+  protected:
+    friend class uint2048_view;
+    friend class int2048_view;
+
+    using _Base_Type = int2048_base;
+    using _Base_Type::_Word_Type;
+    using _Iterator  = _Word_Type *;
+
+    static_assert(_Len >= Word_Length, "Too short to hold a single word!");
+    static_assert(Base * Base < -1ULL / (_Len + 1), "Too long for brute force multiplication!");
+
+    _Word_Type  data[_Len]; /* Data of the integer.       */
+    std::size_t length;     /* Number of words in use.    */
+
+    /* Return the size of the data. */
+    constexpr std::size_t size() const noexcept { return length; }
+
+    /* Set the length to __len with the leading 0s removed. */
+    constexpr void trim(std::size_t __len) noexcept {
+        while (__len != 0 && data[__len - 1] == 0) --__len;
+        length = __len;
+    }
+
+    static uint2048_view wrap(uint2048_view) noexcept;
+
+  public:
+    /* Constructors and assignements. */
+
+    constexpr uint2048() noexcept : data{}, length{0} {}
+
+    /* Construct from a single word. */
+    constexpr uint2048(std::uintmax_t __val) noexcept : data{}, length{0} {
+        while (__val != 0) {
+            data[length++] = __val % Base;
+            __val /= Base;
+        }
+    }
+
+    explicit uint2048(uint2048_view) noexcept;
+    explicit uint2048(int2048_view) noexcept;
+    explicit uint2048(std::string_view) noexcept;
+
+    explicit operator int2048() const;
+
+  public:
+    uint2048 &operator += (uint2048_view) noexcept;
+    uint2048 &operator -= (uint2048_view);
+    uint2048 &operator *= (uint2048_view) noexcept;
+
+    friend uint2048 operator + (uint2048 lhs, uint2048_view rhs) noexcept { return lhs += rhs; }
+    friend uint2048 operator - (uint2048 lhs, uint2048_view rhs) { return lhs -= rhs; }
+    friend uint2048 operator * (uint2048 lhs, uint2048_view rhs) noexcept { return lhs *= rhs; }
+
+    friend constexpr bool operator == (const uint2048 &lhs, const uint2048 &rhs) noexcept {
+        if (lhs.length != rhs.length) return false;
+        for (std::size_t i = 0 ; i != lhs.length ; ++i)
+            if (lhs.data[i] != rhs.data[i]) return false;
+        return true;
+    }
+
+    friend constexpr std::strong_ordering operator <=> (const uint2048 &lhs, const uint2048 &rhs) noexcept {
+        if (lhs.length != rhs.length) return lhs.length <=> rhs.length;
+        for (std::size_t i = lhs.length ; i-- != 0 ; )
+            if (lhs.data[i] != rhs.data[i]) return lhs.data[i] <=> rhs.data[i];
+        return std::strong_ordering::equal;
+    }
+
+  public:
+    std::string to_string() const;
+    void to_string(std::string &) const;
+    std::size_t digits() const noexcept;
+
+    [[nodiscard]]
+    constexpr bool is_zero()        const noexcept { return length == 0; }
+    [[nodiscard]]
+    constexpr bool is_non_zero()    const noexcept { return length != 0; }
+
+    /* Return the maximum possible length of the integer in decimal. */
+    static consteval std::size_t max_digits() noexcept { return _Len * Base_Length; }
+};
+
+/**
+ * @brief A fixed multiplier, whose FFT spectra are cached
+ * so that multiplying it by many integers costs less.
+ * Each multiplication takes only one forward and one inverse
+ * transform for every block of the other operand.
+ * @note It can be used by many threads at the same time.
+ */
+struct prepared_multiplier : int2048_base {
+  protected:
+    using _Base_Type = int2048_base;
+    using _Base_Type::_Word_Type;
+    using _Base_Type::_Container;
+    using _Iterator  = typename _Container::iterator;
+
+    /* Spectra of the value for each FFT length 2^i, built only once. */
+    using _Cache_Type = struct _Spectrum_Cache {
+        std::once_flag  flag[FFT_Max + 1];
+        int2048_helper::vector <complex> data[FFT_Max + 1];
+    };
+
+    _Container  data;   /* Data of the multiplier.  */
+    bool        sign;   /* Sign of the multiplier.  */
+    std::unique_ptr <_Cache_Type> cache;
+
+    const complex *spectrum(std::size_t) const;
+    mul_t mul_pass(_Iterator, uint2048_view) const;
+
+  public:
+    explicit prepared_multiplier(int2048_view);
+
+    prepared_multiplier(prepared_multiplier &&) = default;
+    prepared_multiplier &operator = (prepared_multiplier &&) = default;
+
+    int2048_view value() const noexcept;
+    int2048 mul(int2048_view) const;
+
+    friend int2048 operator * (const prepared_multiplier &, int2048_view);
+    friend int2048 operator * (int2048_view, const prepared_multiplier &);
+};
+
+/**
+ * @brief Reduction modulo a fixed modulus by Barrett's method.
+ * The inverse of the modulus is worked out only once, so each
+ * reduction takes two multiplications and no division.
+ * @note Results are always in [0, modulus). The buffers inside
+ * are reused, so a reducer should not be shared between threads.
+ */
+struct barrett_reducer : int2048_base {
+  protected:
+    using _Base_Type = int2048_base;
+    using _Base_Type::_Word_Type;
+    using _Base_Type::_Container;
+    using _Iterator  = typename _Container::iterator;
+
+    _Container  data;   /* Absolute value of the modulus.           */
+    _Container  rcp;    /* Base^(2n) / modulus, where n = data.size(). */
+
+    mutable _Container temp; /* Buffer of the estimated quotient.   */
+    mutable _Container prod; /* Buffer of the product.             */
+    mutable _Container full; /* Buffer of the input of mulmod.      */
+
+    uint2048_view modulus_view() const noexcept;
+    _Iterator reduce_pass(_Iterator, _Iterator) const;
+    _Iterator reduce_range(_Iterator, _Iterator, bool) const;
+
+  public:
+    explicit barrett_reducer(int2048_view);
+
+    barrett_reducer(barrett_reducer &&) = default;
+    barrett_reducer &operator = (barrett_reducer &&) = default;
+
+    int2048_view modulus() const noexcept;
+    int2048 &reduce(int2048 &) const;
+    int2048 mulmod(int2048_view, int2048_view) const;
+    int2048 &mulmod(int2048 &, int2048_view, int2048_view) const;
+    int2048 pow(int2048_view, int2048_view) const;
+};
+
+/**
+ * @brief Montgomery arithmetic modulo a fixed modulus m with n words.
+ * Numbers are kept as x * R mod m, where R = Base^n, so that each
+ * product is reduced from the lowest words without any division.
+ * @note The modulus should be coprime to Base, that is, neither even
+ * nor a multiple of 5. Its sign is ignored. The buffers inside are
+ * reused, so a context should not be shared between threads.
+ */
+struct montgomery_context : int2048_base {
+  protected:
+    using _Base_Type = int2048_base;
+    using _Base_Type::_Word_Type;
+    using _Base_Type::_Container;
+    using _Iterator  = typename _Container::iterator;
+
+    _Container  data;   /* Absolute value of the modulus.               */
+    _Container  minv;   /* m^(-1) mod R, only for long moduli.          */
+    _Container  rmod;   /* R mod m, which is 1 in Montgomery form.      */
+    _Container  rsqr;   /* R^2 mod m, used to convert into the form.    */
+    _Word_Type  ninv;   /* -m^(-1) mod Base.                            */
+
+    mutable _Container temp; /* Buffer of the product.                  */
+    mutable _Container prod; /* Buffer of the quotient and its product. */
+
+    uint2048_view modulus_view() const noexcept;
+    _Iterator brute_redc(_Iterator, _Iterator, _Iterator) const noexcept;
+    _Iterator redc(_Iterator, _Iterator, _Iterator) const;
+
+  public:
+    explicit montgomery_context(int2048_view);
+
+    montgomery_context(montgomery_context &&) = default;
+    montgomery_context &operator = (montgomery_context &&) = default;
+
+    int2048_view modulus() const noexcept;
+    int2048 to_mont(int2048_view) const;
+    int2048 &from_mont(int2048 &) const;
+    int2048 mulmod(int2048_view, int2048_view) const;
+    int2048 &mulmod(int2048 &, int2048_view, int2048_view) const;
+    int2048 pow(int2048_view, int2048_view) const;
+
+    friend int2048 powmod(int2048_view, int2048_view, int2048_view);
+};
 
 
 } // namespace dark
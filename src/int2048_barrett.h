@@ -0,0 +1,190 @@
+#pragma once
+
+#include "int2048.h"
+
+/* Implementation of barrett reducer. */
+namespace dark {
+
+/**
+ * @brief Prepare a reducer from a given modulus.
+ * @note The modulus should not be 0. Its sign is ignored.
+ */
+barrett_reducer::barrett_reducer(int2048_view src)
+    : data(src._beg, src._end), rcp(data.size() + 2),
+      temp(data.size() * 2 + 3), prod(data.size() * 2 + 3), full() {
+    rcp.resize(inv(rcp.begin(), this->modulus_view()));
+}
+
+/* Return the modulus (always positive). */
+int2048_view barrett_reducer::modulus() const noexcept {
+    return int2048_view {data.begin(), data.end()};
+}
+
+/* Return the absolute value of modulus. */
+uint2048_view barrett_reducer::modulus_view() const noexcept {
+    return uint2048_view {data.begin(), data.end()};
+}
+
+/**
+ * @brief Reduce the number in [__beg, __end) in place, which is less than
+ * Base^(2n), where n is the length of the modulus. With the highest n + 1
+ * words of the number, the quotient is at most a few units less or more.
+ * @return Iterator to the tail of the result.
+ * @note Leading 0s are allowed in the input.
+ */
+auto barrett_reducer::reduce_pass(_Iterator __beg, _Iterator __end) const -> _Iterator {
+    while (__end != __beg && __end[-1] == 0) --__end;
+
+    const auto __mod = this->modulus_view();
+    const std::size_t __n = __mod.size();
+    uint2048_view __val {__beg, __end};
+    if (__val < __mod) return __end;
+
+    const uint2048_view __rcp {rcp.begin(), rcp.end()};
+    const uint2048_view __top {__beg + (__n - 1), __end};
+    const auto __tail = mul(temp.begin(), __top, __rcp);
+
+    uint2048_view __prod {prod.begin(), prod.begin()};
+    if (static_cast <std::size_t> (__tail - temp.begin()) > __n + 1) {
+        const uint2048_view __quo {temp.begin() + (__n + 1), __tail};
+        __prod = { prod.begin(), mul(prod.begin(), __quo, __mod) };
+    }
+
+    /* Too large: take the modulus away from the product. */
+    while (__val < __prod)
+        __prod.resize(__prod == __mod ? 0 : sub(prod.begin(), __prod, __mod) - prod.begin());
+    if (__val == __prod) return __beg;
+
+    /* Too small: take the modulus away from the remainder. */
+    __val.resize(sub(__beg, __val, __prod) - __beg);
+    while (__mod <= __val)
+        __val.resize(__val == __mod ? 0 : sub(__beg, __val, __mod) - __beg);
+    return __beg + __val.size();
+}
+
+/**
+ * @brief Reduce the number in [__beg, __end) in place. Longer numbers
+ * are reduced 2n words at a time, from the highest words.
+ * @param __neg Whether the number is negative.
+ * @return Iterator to the tail of the result, which is in [0, modulus).
+ * @note At least n words should be available from __beg.
+ */
+auto barrett_reducer::reduce_range(_Iterator __beg, _Iterator __end, bool __neg) const -> _Iterator {
+    const auto __mod = this->modulus_view();
+    const std::size_t __n = __mod.size();
+    while (static_cast <std::size_t> (__end - __beg) > __n * 2)
+        __end = this->reduce_pass(__end - __n * 2, __end);
+    __end = this->reduce_pass(__beg, __end);
+
+    /* Negative number: the result is modulus - (|x| mod modulus). */
+    if (__neg && __end != __beg) __end = sub(__beg, __mod, {__beg, __end});
+    return __end;
+}
+
+/**
+ * @brief Reduce the number in place.
+ * @return Reference to the number, which is in [0, modulus).
+ */
+int2048 &barrett_reducer::reduce(int2048 &src) const {
+    src.data.reserve(data.size());
+    src.data.resize(this->reduce_range(src.begin(), src.end(), src.sign));
+    src.sign = false;
+    return src;
+}
+
+/**
+ * @brief Work out lhs * rhs mod modulus to __dst.
+ * @return Reference to __dst, which is in [0, modulus).
+ * @note __dst may be the same as lhs or rhs.
+ */
+int2048 &barrett_reducer::mulmod(int2048 &__dst, int2048_view lhs, int2048_view rhs) const {
+    if (lhs.is_zero() || rhs.is_zero()) return __dst.reset();
+
+    const std::size_t __len = std::max(lhs.size() + rhs.size(), data.size());
+    if (full.capacity() < __len) {
+        full = _Container {};
+        full.init_capacity(__len);
+    }
+
+    const auto __beg = full.begin();
+    auto __end = mul(__beg, lhs.to_unsigned(), rhs.to_unsigned());
+    __end = this->reduce_range(__beg, __end, lhs.sign ^ rhs.sign);
+
+    __dst.data.reserve(data.size());
+    __dst.data.resize(cpy(__dst.begin(), {__beg, __end}));
+    __dst.sign = false;
+    return __dst;
+}
+
+/* Return lhs * rhs mod modulus. */
+int2048 barrett_reducer::mulmod(int2048_view lhs, int2048_view rhs) const {
+    int2048 __ret {};
+    return std::move(this->mulmod(__ret, lhs, rhs));
+}
+
+/**
+ * @brief Return __base^__exp mod modulus.
+ * @note __exp should be non-negative.
+ */
+int2048 barrett_reducer::pow(int2048_view __base, int2048_view __exp) const {
+    int2048 __ret {__exp.is_zero() ? int2048 {_Word_Type {1}} : int2048 {__base}};
+    this->reduce(__ret);
+    if (__exp.is_zero()) return __ret;
+    return pow_window(*this, __ret, __exp);
+}
+
+/**
+ * @brief Work out __base^__exp by sliding windows, where each product is
+ * done by __ctx.mulmod. Only odd powers up to __base^(2^w - 1) are
+ * prepared, and each window of at most w bits costs one product.
+ * @param __base Base which is already reduced by __ctx.
+ * @return The power, which is reduced by __ctx in the same way.
+ * @note __exp should be positive.
+ */
+template <typename _Reducer>
+int2048 int2048_base::pow_window(const _Reducer &__ctx, int2048_view __base, int2048_view __exp) {
+    /* Cut the exponent into 32-bit chunks, from the lowest. */
+    _Container __bits { static_cast <std::size_t> (__exp.end() - __exp.begin()) + 1 };
+    for (int2048 __rest {__exp.set_sign(false)} ; __rest.is_non_zero() ; )
+        __bits.push_back(__rest.divmod(std::uint64_t {1} << 32));
+
+    const std::size_t __len = (__bits.size() - 1) * 32 + std::bit_width(__bits[__bits.size() - 1]);
+    const std::size_t __w   = __len < 8    ? 1 : __len < 36   ? 2 : __len < 140 ? 3 :
+                              __len < 450  ? 4 : __len < 1300 ? 5 : __len < 3500 ? 6 : 7;
+    const auto __bit = [&__bits](std::size_t i) -> bool { return __bits[i >> 5] >> (i & 31) & 1; };
+
+    /* __odd[i] = __base^(2i + 1). */
+    std::unique_ptr <int2048[]> __odd { new int2048[std::size_t {1} << (__w - 1)] };
+    __odd[0] = __base;
+    if (__w != 1) {
+        const int2048 __sqr = __ctx.mulmod(__base, __base);
+        for (std::size_t i = 1 ; i != std::size_t {1} << (__w - 1) ; ++i)
+            __ctx.mulmod(__odd[i], __odd[i - 1], __sqr);
+    }
+
+    /* The table and the result keep their buffers, so nothing grows in the loop. */
+    int2048 __ret {};
+    bool __init = false;
+    for (std::size_t i = __len ; i != 0 ; ) {
+        if (!__bit(i - 1)) {
+            __ctx.mulmod(__ret, __ret, __ret);
+            --i; continue;
+        }
+
+        /* Take the longest window [j, i) which ends with bit 1. */
+        std::size_t j = i > __w ? i - __w : 0;
+        while (!__bit(j)) ++j;
+        std::size_t __val = 0;
+        for (std::size_t k = i ; k-- != j ; ) __val = __val << 1 | __bit(k);
+
+        if (__init) {
+            for (std::size_t k = j ; k != i ; ++k) __ctx.mulmod(__ret, __ret, __ret);
+            __ctx.mulmod(__ret, __ret, __odd[__val >> 1]);
+        } else {
+            __ret  = __odd[__val >> 1];
+            __init = true;
+        } i = j;
+    } return __ret;
+}
+
+} // namespace dark
@@ -1,7 +1,6 @@
 #pragma once
 
 #include "int2048.h"
-#include <numbers>
 
 /* Implementation of arithmetic operators. */
 namespace dark {
@@ -13,6 +12,7 @@ namespace dark {
  * @note The input range cannot be empty!
  */
 char *int2048_base::to_string(char *__buf,uint2048_view src) noexcept {
+    int2048_stats::on_call(int2048_stats::kernel::to_string, src.size());
     auto [__beg,__end] = src;
 
     using namespace std::__detail;
@@ -107,7 +107,7 @@ auto int2048_base::cmp(uint2048_view lhs,uint2048_view rhs) noexcept -> cmp_t {
                 .length = static_cast <std::size_t> (__lhs - __end),
                 .cmp    = *__lhs <=> *__rhs
             };
-    } while (__lhs != __end);
+    } while (__lhs != lhs.begin());
     return cmp_t {0, std::strong_ordering::equal};
 }
 
@@ -165,84 +165,823 @@ noexcept -> sub_t {
     }
 }
 
+/**
+ * @brief Add src to the range [__ptr, __ptr + __len) in place.
+ * @return Whether there is a carry out of the range.
+ * @note __len should be no less than src.size().
+ * Leading 0s are allowed in both ranges.
+ */
+auto int2048_base::add_in(_Iterator __ptr, std::size_t __len, uint2048_view src)
+noexcept -> add_t {
+    const auto __end = __ptr + __len;
+    bool __carry = 0;
+    for (const auto __cur : src) {
+        const _Word_Type __sum = *__ptr + __cur + __carry;
+        *__ptr++ = (__carry = __sum > Base - 1) ? __sum - Base : __sum;
+    }
+    while (__carry && __ptr != __end) {
+        if (++*__ptr == Base) *__ptr++ = 0;
+        else __carry = false;
+    } return __carry;
+}
+
+/**
+ * @brief Sub src from the range [__ptr, __ptr + __len) in place.
+ * @return Whether there is a borrow out of the range.
+ * @note __len should be no less than src.size().
+ * Leading 0s are allowed in both ranges.
+ */
+auto int2048_base::sub_in(_Iterator __ptr, std::size_t __len, uint2048_view src)
+noexcept -> dec_t {
+    const auto __end = __ptr + __len;
+    bool __carry = 0;
+    for (const auto __cur : src) {
+        const _Word_Type __sum = *__ptr - __cur - __carry;
+        *__ptr++ = (__carry = __sum > Base - 1) ? __sum + Base : __sum;
+    }
+    while (__carry && __ptr != __end) {
+        if (*__ptr == 0) *__ptr++ = Base - 1;
+        else --*__ptr, __carry = false;
+    } return __carry;
+}
+
+/**
+ * @brief Multiply src by a small word to __ptr.
+ * @return The carry word out of the range.
+ * @note Exactly src.size() words are written.
+ * __ptr may be equal to src.begin().
+ */
+auto int2048_base::mul_small(_Iterator __ptr, uint2048_view src, _Word_Type __val)
+noexcept -> _Word_Type {
+    _Word_Type __carry = 0;
+    for (const auto __cur : src) {
+        __carry += __cur * __val;
+        *__ptr++ = __carry % Base;
+        __carry /= Base;
+    } return __carry;
+}
+
+/**
+ * @brief Work out the invariant reciprocal of a non-zero word.
+ * @note This takes a real division, so it should be reused.
+ */
+auto int2048_base::make_rcp(_Word_Type __val) noexcept -> rcp_t {
+    using _Wide_Type = unsigned __int128;
+    const int __shift = std::countl_zero(__val);
+    const _Word_Type __div = __val << __shift;
+    const _Wide_Type __num = static_cast <_Wide_Type> (~__div) << 64 | ~_Word_Type {};
+    return rcp_t {
+        .divisor = __div,
+        .inverse = static_cast <_Word_Type> (__num / __div),
+        .shift   = __shift
+    };
+}
+
+/**
+ * @brief Divide (__rest * __base + __cur) by the reciprocal. (Möller-Granlund)
+ * @param __rest Remainder of the higher words, which should be less than the
+ * divisor. It will be replaced by the new remainder.
+ * @return The quotient, which is less than __base.
+ */
+inline auto int2048_base::div_rcp(_Word_Type &__rest, _Word_Type __cur, _Word_Type __base, const rcp_t &__rcp)
+noexcept -> _Word_Type {
+    using _Wide_Type = unsigned __int128;
+    const _Wide_Type __num = (static_cast <_Wide_Type> (__rest) * __base + __cur) << __rcp.shift;
+    const auto __high = static_cast <_Word_Type> (__num >> 64);
+    const auto __low  = static_cast <_Word_Type> (__num);
+
+    const _Wide_Type __est = static_cast <_Wide_Type> (__rcp.inverse) * __high + __num;
+    _Word_Type __quo = static_cast <_Word_Type> (__est >> 64) + 1;
+    _Word_Type __rem = __low - __quo * __rcp.divisor;
+    if (__rem > static_cast <_Word_Type> (__est)) {
+        --__quo;
+        __rem += __rcp.divisor;
+    }
+    if (__builtin_expect(__rem >= __rcp.divisor, false)) {
+        ++__quo;
+        __rem -= __rcp.divisor;
+    }
+
+    __rest = __rem >> __rcp.shift;
+    return __quo;
+}
+
+/**
+ * @brief Divide src by a non-zero word to __ptr.
+ * Two words are divided at a time, which halves the dependency chain.
+ * @return The remainder.
+ * @note Exactly src.size() words are written.
+ * __ptr may be equal to src.begin().
+ */
+auto int2048_base::div_small(_Iterator __ptr, uint2048_view src, _Word_Type __val)
+noexcept -> _Word_Type {
+    const rcp_t __rcp = make_rcp(__val);
+    const auto  __src = src.begin();
+    _Word_Type __rest = 0;
+    std::size_t i = src.size();
+    if (i & 1) --i, __ptr[i] = div_rcp(__rest, __src[i], Base, __rcp);
+    while (i != 0) {
+        i -= 2;
+        const _Word_Type __quo = div_rcp(__rest, __src[i + 1] * Base + __src[i], Base * Base, __rcp);
+        __ptr[i + 1] = __quo / Base;
+        __ptr[i]     = __quo % Base;
+    } return __rest;
+}
+
+/**
+ * @return src mod a non-zero word.
+ * @note Same as div_small, but the quotient is not written.
+ */
+auto int2048_base::mod_small(uint2048_view src, _Word_Type __val)
+noexcept -> _Word_Type {
+    const rcp_t __rcp = make_rcp(__val);
+    const auto  __src = src.begin();
+    _Word_Type __rest = 0;
+    std::size_t i = src.size();
+    if (i & 1) --i, div_rcp(__rest, __src[i], Base, __rcp);
+    while (i != 0) {
+        i -= 2;
+        div_rcp(__rest, __src[i + 1] * Base + __src[i], Base * Base, __rcp);
+    } return __rest;
+}
+
 /**
  * @brief Multiply lhs and rhs to __ptr.
  * @param __ptr Output range.
  * @return Iterator to the tail of the result.
+ * @note The operands may come in any order.
  */
 auto int2048_base::mul(_Iterator __ptr,uint2048_view lhs,uint2048_view rhs)
 -> mul_t {
+    if (lhs.size() < rhs.size()) std::swap(lhs,rhs);
+    if (is_same(lhs,rhs))       return sqr(__ptr,lhs);
     if (use_brute_mul(lhs,rhs)) return brute_mul(__ptr,lhs,rhs);
+    if (rhs.size() < Max_Toom3_Mul_Length) return tier_mul(__ptr,lhs,rhs);
+    if (use_slice_mul(lhs,rhs)) return slice_mul(__ptr,lhs,rhs);
+    if (lhs.size() + rhs.size() > fft_mul_limit) return ntt_mul(__ptr,lhs,rhs);
 
-    // We use decltype(auto) because we may return a reference.
-    // Whether to use reference as optimization depends on implementation.
-    decltype(auto) __fft = make_FFT(lhs , rhs);
-    FFT_pass(__fft);
-
-    auto __cpx  = __fft.begin();
-    auto __cur  = _Word_Type {0};
+    return fft_mul(__ptr,lhs,rhs);
+}
 
-    static_assert(FFT_Zip == 2, "Wrongly implemented!");
-    for(std::size_t i = 0 ; i != __fft.size() ; ++i) {
-        const _Word_Type __lo = std::llround(__cpx++->imag());
-        const _Word_Type __hi = std::llround(__cpx++->imag());
-        __cur   += __hi * FFT_Base + __lo;
-        *__ptr++ = __cur % Base;
-        __cur   /= Base;
-    }
+/**
+ * @brief Normalize the words from __func into __ptr.
+ * For each i, with {lo, hi} = __func(i), the value lo * Base^i + hi * Base^(i+1)
+ * is added to the result. In parallel, each chunk is done independently
+ * and then the carries between the chunks are propagated.
+ * @param __ptr Output range, where exactly __len words are written.
+ * @return The carry out of the highest word.
+ * @note The carry should never overflow.
+ */
+template <typename _Func>
+auto int2048_base::carry_pass(_Iterator __ptr, std::size_t __len, bool __parallel, _Func &&__func)
+-> _Word_Type {
+    using int2048_helper::parallel;
+    auto __pass = [__ptr, &__func](std::size_t __beg, std::size_t __end) -> _Word_Type {
+        _Word_Type __carry = 0;
+        for (std::size_t i = __beg ; i != __end ; ++i) {
+            const auto [__lo, __hi] = __func(i);
+            __carry += __lo;
+            __ptr[i] = __carry % Base;
+            __carry  = __carry / Base + __hi;
+        } return __carry;
+    };
+
+    if (!__parallel) return __pass(0, __len);
+
+    const std::size_t __n = parallel::width();
+    const std::size_t __step = (__len + __n - 1) / __n;
+    _Scratch __carry { __n };
+    parallel::run(__n, [&](std::size_t i) {
+        const std::size_t __beg = std::min(__len, __step * i);
+        const std::size_t __end = std::min(__len, __step * i + __step);
+        __carry[i] = __pass(__beg, __end);
+    });
+
+    _Word_Type __cur = 0;
+    for (std::size_t i = 0 ; i != __n ; ++i) {
+        const std::size_t __end = std::min(__len, __step * i + __step);
+        for (std::size_t j = std::min(__len, __step * i) ; __cur != 0 && j != __end ; ++j) {
+            __cur   += __ptr[j];
+            __ptr[j] = __cur % Base;
+            __cur   /= Base;
+        } __cur += __carry[i];
+    } return __cur;
+}
 
-    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
-    return __ptr;
+/**
+ * @brief Square src to __ptr.
+ * @param __ptr Output range.
+ * @return Iterator to the tail of the result.
+ */
+auto int2048_base::sqr(_Iterator __ptr, uint2048_view src) -> mul_t {
+    if (src.size() < Max_Brute_Mul_Length) return brute_sqr(__ptr,src);
+    if (src.size() < Max_Toom3_Mul_Length) return tier_mul(__ptr,src,src);
+    if (src.size() * 2 > fft_mul_limit) return ntt_mul(__ptr,src,src);
+    return fft_sqr(__ptr,src);
 }
 
+/**
+ * @brief Divide lhs by rhs to __ptr. (Rounded down)
+ * @param __ptr Output range, where at most lhs.size() - rhs.size() + 2
+ * words are written. It should not overlap with lhs or rhs.
+ * @return Iterator to the tail of the quotient.
+ * @note rhs should not be 0.
+ */
 auto int2048_base::div(_Iterator __ptr,uint2048_view lhs,uint2048_view rhs)
 -> div_t {
+    int2048_stats::on_call(int2048_stats::kernel::div, lhs.size());
     if (lhs.size() < rhs.size())    return __ptr;   // Of course 0.
     if (use_brute_div(lhs, rhs))    return brute_div(__ptr,lhs,rhs);
+    if (use_block_div(lhs, rhs)) {
+        _Scratch __rem { rhs.size() };
+        return block_div(__ptr, __rem.begin(), lhs, rhs).first;
+    }
 
-    _Container __buf {}; // Buffer. Maybe it should set static.
-    uint2048_view __quotient = [&__buf, lhs, rhs]() {
-        auto __shift = [](uint2048_view __v, std::size_t __n) {
-            return uint2048_view {__v.begin() + __n, __v.end()};
-        };
-        // Now, delta is at least 1.
-        const std::size_t _Delta = lhs.size() - rhs.size();
-        if (_Delta <= rhs.size()) {
-            __buf.init_capacity(lhs.size() + rhs.size() + 2);
-            return __shift(try_div(__buf.begin(), lhs, rhs), rhs.size() * 2);
-        } else {
-            __buf.init_capacity(lhs.size() * 2 - rhs.size() + 2);
-        }
-    } ();
+    _Scratch __buf {};
+    return adjust_div(__ptr, lhs, rhs, try_div(__buf, lhs, rhs));
+}
 
-    return adjust_div(__ptr, __buf.begin(), lhs, rhs, __quotient);
+/**
+ * @brief Work out lhs mod rhs to __ptr.
+ * @param __ptr Output range, where at most lhs.size() words are written.
+ * It may be equal to lhs.begin(), but should not overlap with rhs.
+ * @return Iterator to the tail of the remainder.
+ * @note rhs should not be 0.
+ */
+auto int2048_base::mod(_Iterator __ptr,uint2048_view lhs,uint2048_view rhs)
+-> mod_t {
+    int2048_stats::on_call(int2048_stats::kernel::div, lhs.size());
+    if (lhs.size() < rhs.size())    return cpy(__ptr, lhs);
+    if (use_brute_div(lhs, rhs))    return brute_mod(__ptr,lhs,rhs);
+    if (use_block_div(lhs, rhs))    return block_div(nullptr, __ptr, lhs, rhs).second;
+
+    _Scratch __buf {};
+    return adjust_mod(__ptr, lhs, rhs, try_div(__buf, lhs, rhs));
+}
+
+/**
+ * @brief Divide lhs by rhs (rounded down), with both the quotient and remainder.
+ * @param __quo Output range of the quotient, where at most lhs.size() -
+ * rhs.size() + 2 words are written. It should not overlap with lhs or rhs.
+ * @param __rem Output range of the remainder, where at most lhs.size() words
+ * are written. It may be equal to lhs.begin(), but should not overlap with rhs.
+ * @return Iterator to the tail of the quotient and the remainder.
+ * @note rhs should not be 0.
+ */
+auto int2048_base::divmod(_Iterator __quo, _Iterator __rem, uint2048_view lhs, uint2048_view rhs)
+-> std::pair <_Iterator, _Iterator> {
+    int2048_stats::on_call(int2048_stats::kernel::div, lhs.size());
+    if (lhs.size() < rhs.size())    return { __quo, cpy(__rem, lhs) };
+    if (use_brute_div(lhs, rhs))    return brute_divmod(__quo, __rem, lhs, rhs);
+    if (use_block_div(lhs, rhs))    return block_div(__quo, __rem, lhs, rhs);
+
+    _Scratch __buf {};
+    return adjust_divmod(__quo, __rem, lhs, rhs, try_div(__buf, lhs, rhs));
 }
 
 /**
  * @brief Use newton method to give a fast and accurate division.
- * Error of this estimation is at most 1.
- * @param __beg Output range. (Custom buffer).
+ * Error of this estimation is at most a few units.
+ * @param __buf Scratch to hold the result, which should not be borrowed yet.
  * @return Range of the result.
+ * @note lhs should be no shorter than rhs.
  */
-auto int2048_base::try_div(_Iterator __beg, uint2048_view lhs, uint2048_view rhs)
+auto int2048_base::try_div(_Scratch &__buf, uint2048_view lhs, uint2048_view rhs)
 -> uint2048_view {
-    _Iterator __tmp = inv(__beg, rhs);
-    _Iterator __end = mul(__beg, lhs, {__beg, __tmp});
-    return{ __beg,__end };
+    /**
+     * The quotient has at most __n - __m + 1 words, so one more word
+     * of precision is enough for the inverse. With __p words of rhs:
+     * lhs / rhs = lhs * inv(top) / Base^(__p + __m), where top is the
+     * highest __p words of rhs (padded with 0s if rhs is too short).
+     */
+    const std::size_t __n = lhs.size();
+    const std::size_t __m = rhs.size();
+    const std::size_t __p = __n - __m + 2;
+
+    /* Only the highest __p words of lhs affect the quotient. */
+    const std::size_t __cut = __n > __p ? __n - __p : 0;
+    const uint2048_view __val {lhs.begin() + __cut, lhs.end()};
+    const std::size_t __shift = __p + __m - __cut;
+
+    /* __buf outlives the others, so it is borrowed first. */
+    __buf.init_capacity(__val.size() + __p + 2);
+
+    _Scratch __pad {};
+    uint2048_view __top {rhs.end() - std::min(__m, __p), rhs.end()};
+    if (__m < __p) {
+        __pad.init_capacity(__p);
+        std::memset(__pad.begin(), 0, (__p - __m) * sizeof(_Word_Type));
+        __top = { __pad.begin(), cpy(__pad.begin() + (__p - __m), rhs) };
+    }
+
+    _Scratch __inv { __p + 2 };
+    const uint2048_view __rev {__inv.begin(), inv(__inv.begin(), __top)};
+
+    const auto __end = mul(__buf.begin(), __val, __rev);
+    if (static_cast <std::size_t> (__end - __buf.begin()) <= __shift)
+        return { __buf.begin(), __buf.begin() };
+    return { __buf.begin() + __shift, __end };
 }
 
 /**
  * @brief Work out the inverse of a number.
- * @param __ptr Output range.
+ * @param __ptr Output range, where at most __val.size() + 2 words are written.
  * @param __val Input number.
- * @return Iterator to the tail of the result.
+ * @return Iterator to the tail of the result, which is an approximation of
+ * Base^(2n) / __val (n = __val.size()) with a relative error of a few Base^(-n).
  */
-auto int2048_base::inv(_Iterator __ptr, uint2048_view __val)
-noexcept -> inv_t {
-    
+auto int2048_base::inv(_Iterator __ptr, uint2048_view __val) -> inv_t {
+    const std::size_t __n   = __val.size();
+    const _Word_Type __scale = Base / (*(__val.end() - 1) + 1);
+
+    /* Normalize the input so that its highest word is no less than Base / 2. */
+    if (__scale == 1) {
+        inv_pass(__ptr, __val);
+    } else {
+        _Scratch __buf { __n };
+        mul_small(__buf.begin(), __val, __scale);
+        inv_pass(__ptr, {__buf.begin(), __buf.begin() + __n});
+    }
+
+    auto __end = __ptr + (__n + 1);
+    if (__scale != 1) {
+        const _Word_Type __carry = mul_small(__ptr, {__ptr, __end}, __scale);
+        if (__carry != 0) *__end++ = __carry;
+    }
+    while (__end[-1] == 0) --__end; // Remove the leading 0s.
+    return __end;
+}
+
+/**
+ * @brief Work out the inverse of a word modulo Base by extended Euclid.
+ * @note __val should be coprime to Base.
+ */
+auto int2048_base::inv_word(_Word_Type __val) noexcept -> _Word_Type {
+    std::int64_t __a = __val % Base, __b = Base, __x = 1, __y = 0;
+    while (__b != 0) {
+        const std::int64_t __q = __a / __b;
+        __a = std::exchange(__b, __a - __q * __b);
+        __x = std::exchange(__y, __x - __q * __y);
+    }
+    return __x < 0 ? __x + Base : __x;
+}
+
+/**
+ * @brief Work out the inverse of __val modulo Base^__k by Hensel lifting.
+ * x = x * (2 - v * x) doubles the number of correct words each time.
+ * @param __ptr Output range, where exactly __k words are written.
+ * @note __val should be coprime to Base.
+ */
+void int2048_base::inv_mod(_Iterator __ptr, uint2048_view __val, std::size_t __k) {
+    const auto __trim = [](auto __beg, auto __end) -> uint2048_view {
+        while (__end != __beg && __end[-1] == 0) --__end;
+        return uint2048_view {__beg, __end};
+    };
+
+    std::memset(__ptr, 0, __k * sizeof(_Word_Type));
+    __ptr[0] = inv_word(*__val.begin());
+    _Scratch __buf { __k * 2 };
+    for (std::size_t __len = 1, __next ; __len < __k ; __len = __next) {
+        __next = std::min(__len * 2, __k);
+
+        /* v * x = 1 + d * Base^len (mod Base^next). */
+        const auto __inv = __trim(__ptr, __ptr + __len);
+        const auto __low = __trim(__val.begin(), __val.begin() + std::min(__next, __val.size()));
+        const auto __end = mul(__buf.begin(), __low, __inv);
+        const auto __top = std::min(__end, __buf.begin() + __next);
+        if (__top <= __buf.begin() + __len) continue;
+        const auto __dif = __trim(__buf.begin() + __len, __top);
+        if (__dif.is_zero()) continue;
+
+        /* x -= x * d * Base^len (mod Base^next). */
+        const auto __tmp  = __buf.begin() + __k;
+        const auto __tail = mul(__tmp, __inv, __dif);
+        std::memset(__tail, 0, (__buf.begin() + __k * 2 - __tail) * sizeof(_Word_Type));
+        bool __carry = 0;
+        for (std::size_t i = 0 ; i != __next - __len ; ++i) {
+            const _Word_Type __cur = Base - __tmp[i] - __carry;
+            __ptr[__len + i] = (__carry = __cur != Base) ? __cur : 0;
+        }
+    }
+}
+
+/**
+ * @brief Divide lhs by rhs, which is known to divide lhs exactly.
+ * As lhs = q * rhs, q = lhs * rhs^(-1) (mod Base^k), where k is the length
+ * of q. So q comes from the lowest words without any estimation.
+ * @param __ptr Output range, where at most lhs.size() - rhs.size() + 1
+ * words are written. It should not overlap with lhs or rhs.
+ * @return Iterator to the tail of the quotient.
+ * @note rhs should not be 0. If rhs does not divide lhs, the result is meaningless.
+ */
+auto int2048_base::exact_div(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs)
+-> div_t {
+    const auto __trim = [](auto __beg, auto __end) -> uint2048_view {
+        while (__end != __beg && __end[-1] == 0) --__end;
+        return uint2048_view {__beg, __end};
+    };
+
+    /* Remove common factors of Base: first Base^t, and then 2^i * 5^j. */
+    while (lhs.size() && *rhs.begin() == 0) {
+        lhs = { lhs.begin() + 1, lhs.end() };
+        rhs = { rhs.begin() + 1, rhs.end() };
+    }
+    if (lhs.size() < rhs.size()) return __ptr;
+
+    /* The quotient never exceeds this, even if rhs gets shorter below. */
+    const std::size_t __cap = lhs.size() - rhs.size() + 1;
+    _Scratch __num {}, __den {};
+    for (_Word_Type __gcd ; (__gcd = std::gcd(*rhs.begin(), Base)) != 1 ; ) {
+        if (__num.capacity() == 0) {
+            __num.init_capacity(lhs.size());
+            __den.init_capacity(rhs.size());
+        }
+        div_small(__num.begin(), lhs, __gcd);
+        div_small(__den.begin(), rhs, __gcd);
+        lhs = __trim(__num.begin(), __num.begin() + lhs.size());
+        rhs = __trim(__den.begin(), __den.begin() + rhs.size());
+        if (lhs.size() < rhs.size()) return __ptr;
+    }
+
+    const std::size_t __k = std::min(lhs.size() - rhs.size() + 1, __cap);
+    if (std::min(__k, rhs.size()) < Max_Brute_Mul_Length) {
+        brute_exact_div(__ptr, lhs, rhs, __k);
+    } else {
+        _Scratch __inv { __k };
+        inv_mod(__inv.begin(), rhs, __k);
+
+        const auto __low = __trim(lhs.begin(), lhs.begin() + std::min(__k, lhs.size()));
+        _Scratch __buf { __low.size() + __k };
+        const auto __end = mul(__buf.begin(), __low, __trim(__inv.begin(), __inv.begin() + __k));
+        std::memset(__end, 0, (__buf.begin() + (__low.size() + __k) - __end) * sizeof(_Word_Type));
+        cpy(__ptr, {__buf.begin(), __buf.begin() + __k});
+    }
+
+    auto __end = __ptr + __k;
+    while (__end != __ptr && __end[-1] == 0) --__end; // Remove the leading 0s.
+    return __end;
+}
+
+/**
+ * @brief Exact division word by word (Jebelean's method). Each word of
+ * the quotient is the lowest word of the rest times the inverse of the
+ * lowest word of rhs, and then its product is taken away from the rest.
+ * Only the lowest __k words of the rest are ever needed. They are not
+ * normalized until used, which is safe as either __k or rhs.size() is
+ * less than Max_Brute_Mul_Length (just the same as brute_mul).
+ * @param __ptr Output range, where exactly __k words are written.
+ */
+void int2048_base::brute_exact_div(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs, std::size_t __k)
+noexcept {
+    using _Signed_Type = std::make_signed_t <_Word_Type>;
+    constexpr auto _Base = static_cast <_Signed_Type> (Base);
+
+    const std::size_t __m = rhs.size();
+    const auto __v = rhs.begin();
+    const _Word_Type __rcp = inv_word(*__v);
+
+    /* The rest is kept in __ptr, which is replaced by the quotient word by word. */
+    const auto __rest = reinterpret_cast <_Signed_Type *> (__ptr);
+    const auto __end  = cpy(__ptr, {lhs.begin(), lhs.begin() + std::min(__k, lhs.size())});
+    std::memset(__end, 0, (__ptr + __k - __end) * sizeof(_Word_Type));
+
+    for (std::size_t i = 0 ; i != __k ; ++i) {
+        const _Signed_Type __cur = __rest[i] % _Base;
+        const _Word_Type __low = static_cast <_Word_Type> (__cur < 0 ? __cur + _Base : __cur);
+        const _Word_Type __q   = __low * __rcp % Base;
+        const std::size_t __len = std::min(__m, __k - i);
+        for (std::size_t j = 0 ; j != __len ; ++j)
+            __rest[i + j] -= static_cast <_Signed_Type> (__q * __v[j]);
+        if (i + 1 != __k) __rest[i + 1] += __rest[i] / _Base;
+        __ptr[i] = __q;
+    }
+}
+
+/**
+ * @brief Newton iteration of the inverse, doubling the precision each time.
+ * With X ~ Base^(2h) / V_h, where V_h is the highest h words of V:
+ * Base^(2n) / V ~ X * Base^(n - h) + X * (Base^(n + h) - X * V) / Base^(2h).
+ * @param __ptr Output range, where exactly __val.size() + 1 words are written.
+ * @param __val Input number, whose highest word is no less than Base / 2.
+ */
+void int2048_base::inv_pass(_Iterator __ptr, uint2048_view __val) {
+    const std::size_t __n = __val.size();
+    if (__n <= 2) {
+        using _Wide_Type = unsigned __int128;
+        _Wide_Type __num = 1;
+        for (std::size_t i = 0 ; i != __n * 2 ; ++i) __num *= Base;
+        __num /= narrow_down(__val.begin(), __n);
+        for (std::size_t i = 0 ; i <= __n ; ++i) {
+            __ptr[i] = static_cast <_Word_Type> (__num % Base);
+            __num /= Base;
+        } return;
+    }
+
+    auto __trim = [](_Iterator __beg, _Iterator __end) -> uint2048_view {
+        while (__end != __beg && __end[-1] == 0) --__end;
+        return { __beg, __end };
+    };
+
+    /* With 2h >= n + 1 (and a normalized input), the error will never grow. */
+    const std::size_t __h = __n / 2 + 1;
+    const std::size_t __k = __n + __h;
+    inv_pass(__ptr + (__n - __h), {__val.end() - __h, __val.end()});
+    const auto __rev = __trim(__ptr + (__n - __h), __ptr + (__n + 1));
+
+    /* __tmp = |Base^k - X * V|, which is about Base^n. */
+    _Scratch __tmp { __k + 1 };
+    const auto __beg = __tmp.begin();
+    auto __end = mul(__beg, __rev, __val);
+    std::memset(__end, 0, (__beg + __k + 1 - __end) * sizeof(_Word_Type));
+    const bool __neg = __beg[__k] != 0;
+    if (!__neg) {
+        for (std::size_t i = 0 ; i != __k ; ++i) __beg[i] = Base - 1 - __beg[i];
+        inc(__beg, {__beg, __beg + __k});
+    }
+
+    std::memset(__ptr, 0, (__n - __h) * sizeof(_Word_Type));
+    const auto __dif = __trim(__beg + (__h - 1), __beg + __k);
+    if (__dif.is_zero()) return;
+
+    _Scratch __buf { __rev.size() + __dif.size() };
+    __end = mul(__buf.begin(), __rev, __dif);
+    if (static_cast <std::size_t> (__end - __buf.begin()) <= __h + 1) return;
+
+    const uint2048_view __fix {__buf.begin() + (__h + 1), __end};
+    if (__neg) sub_in(__ptr, __n + 1, __fix);
+    else       add_in(__ptr, __n + 1, __fix);
+}
+
+/**
+ * @brief Correct the estimated quotient of lhs / rhs with the remainder.
+ * @param __ptr Output range of the remainder, where at most lhs.size()
+ * words are written. It may be equal to lhs.begin().
+ * @param __quo Estimated quotient, which may be off by a few units.
+ * @return Iterator to the tail of the remainder,
+ * and the difference between the real quotient and __quo.
+ */
+auto int2048_base::adjust_pass(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs, uint2048_view __quo)
+-> std::pair <_Iterator, std::ptrdiff_t> {
+    _Scratch __buf { __quo.size() + rhs.size() };
+    uint2048_view __prod {__buf.begin(), __buf.begin()};
+    if (__quo.is_non_zero()) __prod = { __buf.begin(), mul(__buf.begin(), __quo, rhs) };
+
+    std::ptrdiff_t __delta = 0;
+    /* Too large: take rhs away from the product. */
+    while (lhs < __prod) {
+        __prod.resize(__prod == rhs ? 0 : sub(__buf.begin(), __prod, rhs) - __buf.begin());
+        --__delta;
+    }
+
+    if (lhs == __prod) return { __ptr, __delta };
+    uint2048_view __rest {__ptr, sub(__ptr, lhs, __prod)};
+
+    /* Too small: take rhs away from the remainder. */
+    while (rhs <= __rest) {
+        __rest.resize(__rest == rhs ? 0 : sub(__ptr, __rest, rhs) - __ptr);
+        ++__delta;
+    }
+
+    return { __ptr + __rest.size(), __delta };
+}
+
+/**
+ * @brief Correct the estimated quotient of lhs / rhs.
+ * @param __ptr Output range of the quotient.
+ * @param __quo Estimated quotient, which may be off by a few units.
+ * @return Iterator to the tail of the quotient.
+ */
+auto int2048_base::adjust_div(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs, uint2048_view __quo)
+-> div_t {
+    _Scratch __buf { lhs.size() };
+    return adjust_divmod(__ptr, __buf.begin(), lhs, rhs, __quo).first;
+}
+
+/**
+ * @brief Correct the estimated quotient of lhs / rhs, and work out the remainder.
+ * @param __ptr Output range of the remainder, which may be equal to lhs.begin().
+ * @param __quo Estimated quotient, which may be off by a few units.
+ * @return Iterator to the tail of the remainder.
+ */
+auto int2048_base::adjust_mod(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs, uint2048_view __quo)
+-> mod_t {
+    return adjust_pass(__ptr, lhs, rhs, __quo).first;
+}
+
+/**
+ * @brief Correct the estimated quotient of lhs / rhs to __quo,
+ * with the remainder from the same pass.
+ * @param __quo Output range of the quotient. It may be equal to __est.begin().
+ * @param __rem Output range of the remainder, which may be equal to lhs.begin().
+ * @param __est Estimated quotient, which may be off by a few units.
+ * @return Iterator to the tail of the quotient and the remainder.
+ */
+auto int2048_base::adjust_divmod(_Iterator __quo, _Iterator __rem, uint2048_view lhs, uint2048_view rhs, uint2048_view __est)
+-> std::pair <_Iterator, _Iterator> {
+    auto [__rest, __delta] = adjust_pass(__rem, lhs, rhs, __est);
+
+    auto __end = cpy(__quo, __est);
+    for (; __delta < 0 ; ++__delta) __end -= dec(__quo, {__quo, __end});
+    for (; __delta > 0 ; --__delta) if (inc(__quo, {__quo, __end})) *__end++ = 1;
+    return { __end, __rest };
+}
+
+/**
+ * @return Whether lhs should be divided by rhs block by block.
+ * @note Otherwise, the inverse in try_div would be as long as the quotient.
+ */
+inline bool int2048_base::use_block_div(uint2048_view lhs, uint2048_view rhs) noexcept {
+    return lhs.size() >= rhs.size() * Min_Block_Div_Ratio;
+}
+
+/**
+ * @brief Divide lhs by rhs block by block, from the highest words.
+ * Each block of rhs.size() words of the quotient is done by block_pass,
+ * so the buffers are only a few times as long as rhs.
+ * @param __quo Output range of the quotient, where exactly lhs.size() -
+ * rhs.size() + 2 words are written. If it is nullptr, the quotient is
+ * not kept. It should not overlap with lhs or rhs.
+ * @param __rem Output range of the remainder, where at most rhs.size()
+ * words are written. It may be equal to lhs.begin().
+ * @return Iterator to the tail of the quotient and the remainder.
+ */
+auto int2048_base::block_div(_Iterator __quo, _Iterator __rem, uint2048_view lhs, uint2048_view rhs)
+-> std::pair <_Iterator, _Iterator> {
+    const std::size_t __n = lhs.size();
+    const std::size_t __m = rhs.size();
+    const _Word_Type __scale = Base / (*(rhs.end() - 1) + 1);
+
+    /* Normalize rhs, so that each estimation is at most 2 too large. */
+    _Scratch __den { __m };
+    if (__scale != 1) {
+        mul_small(__den.begin(), rhs, __scale);
+        rhs = { __den.begin(), __den.begin() + __m };
+    }
+
+    /**
+     * lhs * __scale has __n + 1 words (the highest may be 0), which is
+     * never built as a whole. Instead, the carry into each block is kept,
+     * and each block is scaled only when it is used.
+     */
+    const std::size_t _Length = __n - __m + 2;
+    const std::size_t __count = (_Length + __m - 1) / __m;
+    _Scratch __carry { __count };
+    _Word_Type __cur = 0;
+    for (std::size_t i = 0 ; i != __count ; ++i) {
+        __carry[i] = __cur;
+        const auto __beg = lhs.begin() + std::min(__n, i * __m);
+        const auto __end = lhs.begin() + std::min(__n, i * __m + __m);
+        for (auto __it = __beg ; __it != __end ; ++__it) __cur = (*__it * __scale + __cur) / Base;
+    }
+    const auto __load = [&](_Iterator __ptr, std::size_t __beg, std::size_t __end) {
+        _Word_Type __cur = __carry[__beg / __m];
+        for (std::size_t i = __beg ; i != __end ; ++i) {
+            const _Word_Type __val = (i < __n ? lhs.begin()[i] : 0) * __scale + __cur;
+            *__ptr++ = __val % Base;
+            __cur    = __val / Base;
+        }
+    };
+    const auto __trim = [](auto __beg, auto __end) -> uint2048_view {
+        while (__end != __beg && __end[-1] == 0) --__end;
+        return { __beg, __end };
+    };
+
+    _Scratch __num { __m * 2 };
+    _Scratch __res { __m + 1 };
+    _Scratch __tmp { __quo == nullptr ? __m : 0 };
+    uint2048_view __rest { __res.begin(), __res.begin() };
+
+    /* The highest block takes the rest, where the quotient is shorter. */
+    for (std::size_t i = __count ; i-- != 0 ; ) {
+        const std::size_t __beg = i * __m;
+        const std::size_t __len = std::min(__m, _Length - __beg);
+        const auto __out = __quo == nullptr ? __tmp.begin() : __quo + __beg;
+
+        uint2048_view __val;
+        if (i + 1 == __count) {
+            __load(__num.begin(), __beg, __n + 1);
+            __val = __trim(__num.begin(), __num.begin() + (__n + 1 - __beg));
+        } else {
+            __load(__num.begin(), __beg, __beg + __m);
+            __val = __trim(__num.begin(), cpy(__num.begin() + __m, __rest));
+        }
+        __rest = { __res.begin(), block_pass(__out, __res.begin(), __val, rhs, __len) };
+    }
+
+    /* The remainder is also scaled, which is divided back exactly. */
+    auto __end = cpy(__rem, __rest);
+    if (__scale != 1 && __end != __rem) {
+        div_small(__rem, __rest, __scale);
+        if (__end[-1] == 0) --__end;
+    }
+    if (__quo == nullptr) return { __quo, __end };
+    auto __tail = __quo + _Length;
+    while (__tail != __quo && __tail[-1] == 0) --__tail;
+    return { __tail, __end };
 }
 
+/**
+ * @brief Recursive division by Burnikel and Ziegler.
+ * If rhs is no longer than the quotient, the quotient is cut into 2 halves,
+ * which are worked out one by one (2n / 1n). Otherwise, the highest
+ * __k words of rhs give an estimation, which is then fixed by the lower
+ * words of rhs (3n / 2n). The multiplications are left to mul.
+ * @param __quo Output range, where exactly __k words of quotient are written.
+ * @param __rem Output range, where at most rhs.size() + 1 words are
+ * written for the remainder. It should not overlap with lhs.
+ * @param rhs Divisor, whose highest word is no less than Base / 2.
+ * @return Iterator to the tail of the remainder.
+ * @note lhs should be less than rhs * Base^__k.
+ */
+auto int2048_base::block_pass(_Iterator __quo, _Iterator __rem, uint2048_view lhs, uint2048_view rhs, std::size_t __k)
+-> _Iterator {
+    const std::size_t __n = rhs.size();
+    const auto __trim = [](auto __beg, auto __end) -> uint2048_view {
+        while (__end != __beg && __end[-1] == 0) --__end;
+        return { __beg, __end };
+    };
+
+    /* Short enough: just use Knuth's algorithm D. */
+    if (__n < Max_Brute_Div_Length || __k < Max_Brute_Div_Length) {
+        _Scratch __buf { __n + __k };
+        const auto __end = cpy(__buf.begin(), lhs);
+        std::memset(__end, 0, (__buf.begin() + (__n + __k) - __end) * sizeof(_Word_Type));
+        knuth_pass(__quo, __buf.begin(), __n + __k, rhs);
+        return cpy(__rem, __trim(__buf.begin(), __buf.begin() + __n));
+    }
+
+    /* Long enough: the newton method is faster for each block. */
+    if (__n >= Max_Block_Div_Length) {
+        std::memset(__quo, 0, __k * sizeof(_Word_Type));
+        if (lhs < rhs) return cpy(__rem, lhs);
+
+        _Scratch __tmp { lhs.size() };
+        _Scratch __buf {};
+        const auto __end = adjust_divmod(__quo, __tmp.begin(), lhs, rhs, try_div(__buf, lhs, rhs)).second;
+        return cpy(__rem, {__tmp.begin(), __end});
+    }
+
+    if (__n <= __k) {
+        /* The highest __k1 words of quotient, and then the lowest __k2 words. */
+        const std::size_t __k2 = __k / 2;
+        const std::size_t __k1 = __k - __k2;
+        const auto __cut = lhs.begin() + std::min(__k2, lhs.size());
+
+        _Scratch __buf { __n + __k2 + 1 };
+        const auto __mid = block_pass(__quo + __k2, __buf.begin() + __k2, {__cut, lhs.end()}, rhs, __k1);
+        const auto __low = cpy(__buf.begin(), {lhs.begin(), __cut});
+        std::memset(__low, 0, (__buf.begin() + __k2 - __low) * sizeof(_Word_Type));
+        return block_pass(__quo, __rem, __trim(__buf.begin(), __mid), rhs, __k2);
+    }
+
+    /* rhs = __hi * Base^__s + __lo, where __hi has __k words. */
+    const std::size_t __s = __n - __k;
+    const uint2048_view __hi {rhs.begin() + __s, rhs.end()};
+    const uint2048_view __lo = __trim(rhs.begin(), rhs.begin() + __s);
+    const auto __cut = lhs.begin() + std::min(__s, lhs.size());
+    const uint2048_view __top {__cut, lhs.end()};
+
+    /**
+     * Estimate the quotient with __top / __hi, whose remainder is put
+     * at __s. If the highest words of __top are equal to __hi (they are
+     * never larger), the estimation is Base^__k - 1, and the remainder
+     * is __top - __hi * (Base^__k - 1) = (__top mod Base^__k) + __hi.
+     */
+    _Scratch __buf { __n + 1 };
+    const auto __ptr = __buf.begin() + __s;
+    const auto __half = __top.begin() + std::min(__k, __top.size());
+    auto __end = __ptr;
+    if (uint2048_view {__half, __top.end()} < __hi) {
+        __end = block_pass(__quo, __ptr, __top, __hi, __k);
+    } else {
+        std::fill_n(__quo, __k, Base - 1);
+        __end = __ptr + __k;
+        if (add(__ptr, __hi, __trim(__top.begin(), __half))) *__end++ = 1;
+    }
+    const auto __low = cpy(__buf.begin(), {lhs.begin(), __cut});
+    std::memset(__low, 0, (__ptr - __low) * sizeof(_Word_Type));
+
+    /* Fix the remainder with the lower words: __rest -= __quo * __lo. */
+    uint2048_view __rest = __trim(__buf.begin(), __end);
+    const uint2048_view __est = __trim(__quo, __quo + __k);
+    if (__est.is_zero() || __lo.is_zero()) return cpy(__rem, __rest);
+
+    _Scratch __tmp { __est.size() + __lo.size() };
+    const uint2048_view __prod {__tmp.begin(), mul(__tmp.begin(), __est, __lo)};
+    while (__rest < __prod) {
+        auto __tail = __buf.begin() + std::max(__rest.size(), __n);
+        if (__rest.size() >= __n ? add(__buf.begin(), __rest, rhs) : add(__buf.begin(), rhs, __rest))
+            *__tail++ = 1;
+        __rest = { __buf.begin(), __tail };
+
+        auto __it = __quo;
+        while (*__it == 0) *__it++ = Base - 1;
+        --*__it;
+    }
 
+    if (__rest == __prod) return __rem;
+    return sub(__rem, __rest, __prod);
+}
 
 } // namespace dark
 
@@ -258,6 +997,31 @@ bool int2048_base::use_brute_mul(uint2048_view &lhs, uint2048_view &rhs) noexcep
     return lhs.size() < Max_Brute_Mul_Length;
 }
 
+void int2048_base::set_threads(std::size_t __n, std::size_t __min) {
+    using int2048_helper::parallel;
+    using int2048_helper::thread_pool;
+    parallel::pool.reset(__n > 1 ? new thread_pool {__n} : nullptr);
+    parallel::threshold = __min;
+}
+
+void int2048_base::set_ntt_threshold(std::size_t __n) noexcept {
+    fft_mul_limit = std::min(__n, Max_FFT_Mul_Length);
+}
+
+/**
+ * @return Whether lhs should be cut into blocks to multiply rhs.
+ * @note lhs should be no smaller than rhs in size.
+ */
+inline bool int2048_base::use_slice_mul(uint2048_view lhs, uint2048_view rhs) noexcept {
+    return rhs.size() * 2 <= fft_mul_limit
+        && lhs.size() >= rhs.size() * Min_Slice_Mul_Ratio;
+}
+
+/* Whether lhs and rhs are exactly the same range. */
+inline bool int2048_base::is_same(uint2048_view lhs, uint2048_view rhs) noexcept {
+    return lhs._beg == rhs._beg && lhs._end == rhs._end;
+}
+
 /**
  * @brief Brute force multiplication.
  * @param __ptr Output range.
@@ -265,6 +1029,7 @@ bool int2048_base::use_brute_mul(uint2048_view &lhs, uint2048_view &rhs) noexcep
  */
 auto int2048_base::brute_mul(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs)
 noexcept -> mul_t {
+    int2048_stats::on_call(int2048_stats::kernel::brute_mul, std::max(lhs.size(), rhs.size()));
     // First, we clear the memory for the result.
     // This requires that input ranges should not overlap with output range.
     std::memset(__ptr, 0, (lhs.size() + rhs.size()) * sizeof(_Word_Type));
@@ -291,41 +1056,339 @@ noexcept -> mul_t {
 }
 
 /**
- * @param _Max_Length The maximum length of the array.
- * @return Return the fft array generated by lhs and rhs.
- * Its capacity is the fft length.
- * Its size is the maximum length of the result.
- * @note lhs should be no smaller than rhs in size.
+ * @brief Brute force squaring, where each cross product is computed once.
+ * @param __ptr Output range.
+ * @return Iterator to the tail of the result.
+ * @note src should be shorter than Max_Brute_Mul_Length.
+ * Input range should not overlap with output range.
  */
-auto int2048_base::make_FFT(uint2048_view lhs,uint2048_view rhs) -> FFT_t {
-    static_assert(FFT_Zip == 2, "Wrongly implemented!");
+auto int2048_base::brute_sqr(_Iterator __ptr, uint2048_view src) noexcept -> mul_t {
+    int2048_stats::on_call(int2048_stats::kernel::brute_mul, src.size());
+    const std::size_t __n = src.size();
+    const auto __src = src.begin();
+    std::memset(__ptr, 0, __n * 2 * sizeof(_Word_Type));
+
+    for (std::size_t i = 0 ; i != __n ; ++i)
+        for (std::size_t j = i + 1 ; j != __n ; ++j)
+            __ptr[i + j] += __src[i] * __src[j];
+
+    /* Double the cross products and add the squares. */
+    _Word_Type __carry = 0;
+    for (std::size_t i = 0 ; i != __n ; ++i) {
+        __carry += __ptr[0] * 2 + __src[i] * __src[i];
+        *__ptr++ = __carry % Base;
+        __carry /= Base;
+        __carry += __ptr[0] * 2;
+        *__ptr++ = __carry % Base;
+        __carry /= Base;
+    }
+
+    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+    return __ptr;
+}
+
+/**
+ * @brief Call __func with the digits per point as a constant.
+ * @note Only digits in [Min_FFT_Digits, Max_FFT_Digits] are allowed.
+ */
+template <typename _Func>
+inline decltype(auto) int2048_base::FFT_visit(std::size_t __digits, _Func &&__func) {
+    static_assert(Min_FFT_Digits == 3 && Max_FFT_Digits == 6, "Wrongly implemented!");
+    switch (__digits) {
+        case 3: return __func(std::integral_constant <std::size_t, 3> {});
+        case 4: return __func(std::integral_constant <std::size_t, 4> {});
+        case 5: return __func(std::integral_constant <std::size_t, 5> {});
+        case 6: return __func(std::integral_constant <std::size_t, 6> {});
+        default: __builtin_unreachable();
+    }
+}
+
+/**
+ * @brief Cut src into points of _Digits decimal digits from low
+ * to high, and call __func(i, __val) for the i-th point.
+ */
+template <std::size_t _Digits, typename _Func>
+inline void int2048_base::split_digits(uint2048_view src, _Func &&__func) {
     using namespace int2048_helper;
+    static_assert(_Digits < Base_Length, "Wrongly implemented!");
+    constexpr _Word_Type _Unit = __pow(10U, _Digits);
+    constexpr _Word_Type _Pow[Base_Length] = {
+        __pow(10U, 0), __pow(10U, 1), __pow(10U, 2), __pow(10U, 3),
+        __pow(10U, 4), __pow(10U, 5), __pow(10U, 6), __pow(10U, 7)
+    };
+
+    /* __acc holds the lowest __have digits not taken yet. */
+    _Word_Type  __acc  = 0;
+    std::size_t __have = 0;
+    const std::size_t __len = FFT_points(src.size(), _Digits);
+    auto __beg = src.begin();
+    for (std::size_t i = 0 ; i != __len ; ++i) {
+        if (__have < _Digits && __beg != src.end()) {
+            __acc  += *__beg++ * _Pow[__have];
+            __have += Base_Length;
+        }
+        __func(i, static_cast <double> (__acc % _Unit));
+        __acc  /= _Unit;
+        __have -= std::min(__have, _Digits);
+    }
+}
 
-    const auto _Max_Length = lhs.size() + rhs.size();
-    const auto _Bit_Length = 2 + __log2(_Max_Length - 1);
-    const auto _Length     = std::size_t {1} << _Bit_Length;
+/**
+ * @brief Gather the points of _Digits decimal digits falling in word i.
+ * @param __coef Function returning the value of the k-th point.
+ * @return {lo, hi} such that their value is lo + hi * Base.
+ * It can be used as the input of carry_pass.
+ */
+template <std::size_t _Digits, typename _Func>
+inline auto int2048_base::merge_digits(std::size_t i, _Func &&__coef)
+-> std::pair <_Word_Type, _Word_Type> {
+    using namespace int2048_helper;
+    /* Split __val * 10^_Off into the low word and the rest. */
+    auto __shift = [](_Word_Type __val, auto _Off) -> std::pair <_Word_Type, _Word_Type> {
+        constexpr _Word_Type _Div = __pow(10U, Base_Length - _Off);
+        return { __val % _Div * __pow(10U, _Off), __val / _Div };
+    };
+    using _Index = std::size_t;
+
+    /* Fast path: the default packing never overflows. */
+    if constexpr (_Digits == FFT_BaseLen) {
+        static_assert(Base_Length == FFT_BaseLen * 2, "Wrongly implemented!");
+        return { __coef(i * 2) + __coef(i * 2 + 1) * FFT_Base, 0 };
+    }
+
+    std::size_t k = (i * Base_Length + _Digits - 1) / _Digits;
+    std::size_t __off = k * _Digits - i * Base_Length;
+    _Word_Type __lo = 0, __hi = 0;
+    for (; __off < Base_Length ; __off += _Digits, ++k) {
+        const _Word_Type __val = __coef(k);
+        std::pair <_Word_Type, _Word_Type> __cur;
+        switch (__off) {
+            case 0: __cur = __shift(__val, std::integral_constant <_Index, 0> {}); break;
+            case 1: __cur = __shift(__val, std::integral_constant <_Index, 1> {}); break;
+            case 2: __cur = __shift(__val, std::integral_constant <_Index, 2> {}); break;
+            case 3: __cur = __shift(__val, std::integral_constant <_Index, 3> {}); break;
+            case 4: __cur = __shift(__val, std::integral_constant <_Index, 4> {}); break;
+            case 5: __cur = __shift(__val, std::integral_constant <_Index, 5> {}); break;
+            case 6: __cur = __shift(__val, std::integral_constant <_Index, 6> {}); break;
+            case 7: __cur = __shift(__val, std::integral_constant <_Index, 7> {}); break;
+            default: __builtin_unreachable();
+        }
+        __lo += __cur.first;
+        __hi += __cur.second;
+    } return {__lo, __hi};
+}
+
+/**
+ * @brief Number of points of src cut into __digits digits each.
+ */
+inline std::size_t int2048_base::FFT_points(std::size_t __len, std::size_t __digits) noexcept {
+    return (__len * Base_Length + __digits - 1) / __digits;
+}
+
+/**
+ * @brief Multiply lhs and rhs to __ptr with FFT, where
+ * the digits per point are chosen by the length.
+ * Both inputs are packed as real sequences of half length,
+ * so it takes 3 transforms of about (n + m) points in total.
+ * @param __ptr Output range.
+ * @return Iterator to the tail of the result.
+ */
+auto int2048_base::fft_mul(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs) -> mul_t {
+    int2048_stats::on_call(int2048_stats::kernel::fft_mul, std::max(lhs.size(), rhs.size()));
+    const std::size_t __digits = FFT_digits(lhs.size(), rhs.size());
+    const std::size_t __words  = lhs.size() + rhs.size();
+    const std::size_t __points = FFT_points(lhs.size(), __digits)
+                               + FFT_points(rhs.size(), __digits);
+    const std::size_t _Length  = FFT_length(__points >> 1);
+
+    FFT_t __lhs, __rhs;
+    __lhs.init_capacity(_Length);
+    __rhs.init_capacity(_Length);
+    load_FFT(__lhs.begin(), lhs, _Length, __digits);
+    load_FFT(__rhs.begin(), rhs, _Length, __digits);
+
+    const bool __parallel = int2048_helper::parallel::enabled(__words);
+    FFT_mul_pass(__lhs.begin(), __rhs.begin(), _Length, __parallel);
+    if (!FFT_guard(__lhs.begin(), _Length, __parallel))
+        return ntt_mul(__ptr,lhs,rhs);
+    unload_FFT(__ptr, __lhs.begin(), __words, _Length, __digits, __parallel);
+
+    __ptr += __words;
+    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+    return __ptr;
+}
+
+/**
+ * @brief Square src to __ptr with a half-length FFT.
+ * Each two points are packed as one complex number,
+ * which is exactly the packing of a real FFT of double length.
+ * @param __ptr Output range.
+ * @return Iterator to the tail of the result.
+ */
+auto int2048_base::fft_sqr(_Iterator __ptr, uint2048_view src) -> mul_t {
+    int2048_stats::on_call(int2048_stats::kernel::fft_mul, src.size());
+    const std::size_t __digits = FFT_digits(src.size(), src.size());
+    const std::size_t __words  = src.size() * 2;
+    const std::size_t _Length  = FFT_length(FFT_points(src.size(), __digits));
 
     FFT_t __fft;
     __fft.init_capacity(_Length);
-    __fft.resize(_Max_Length);
+    load_FFT(__fft.begin(), src, _Length, __digits);
 
-    auto *__ptr = __fft.begin();
-    auto [__beg,__end] = lhs;
+    const bool __parallel = int2048_helper::parallel::enabled(__words);
+    FFT_sqr_pass(__fft, __parallel);
+    if (!FFT_guard(__fft.begin(), _Length, __parallel))
+        return ntt_mul(__ptr, src, src);
+    unload_FFT(__ptr, __fft.begin(), __words, _Length, __digits, __parallel);
 
-    for (const auto __rhs : rhs) {
-        const auto __lhs = *__beg++;
-        *__ptr++ = complex(__lhs % FFT_Base, __rhs % FFT_Base);
-        *__ptr++ = complex(__lhs / FFT_Base, __rhs / FFT_Base);
+    __ptr += __words;
+    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+    return __ptr;
+}
+
+/**
+ * @brief Precision guard of FFT products, which checks that the
+ * first __len packed results are all close enough to integers.
+ * Results out of the bound may have been rounded wrongly,
+ * and the product should be recomputed exactly instead.
+ * @param __parallel Whether to use the thread pool.
+ * @return Whether the results can be trusted.
+ */
+bool int2048_base::FFT_guard(const complex *__cpx, std::size_t __len, bool __parallel) {
+    using int2048_helper::parallel;
+    auto __pass = [__cpx](std::size_t __beg, std::size_t __end) -> double {
+        double __err = 0;
+        for (std::size_t i = __beg ; i != __end ; ++i) {
+            const auto __val = __cpx[i];
+            __err = std::max(__err, std::abs(__val.real() - FFT_round(__val.real())));
+            __err = std::max(__err, std::abs(__val.imag() - FFT_round(__val.imag())));
+        } return __err;
+    };
+
+    double __err = 0;
+    if (!__parallel) {
+        __err = __pass(0, __len);
+    } else {
+        const std::size_t __n = parallel::width();
+        const std::size_t __step = (__len + __n - 1) / __n;
+        int2048_helper::vector <double> __errs { __n };
+        parallel::run(__n, [&](std::size_t i) {
+            const std::size_t __beg = std::min(__len, __step * i);
+            const std::size_t __end = std::min(__len, __step * i + __step);
+            __errs.begin()[i] = __pass(__beg, __end);
+        });
+        for (std::size_t i = 0 ; i != __n ; ++i) __err = std::max(__err, __errs.begin()[i]);
     }
-    while(__beg != __end) {
-        const auto __val = *__beg++;
-        *__ptr++ = complex(__val % FFT_Base);
-        *__ptr++ = complex(__val / FFT_Base);
+
+    const bool __ok = __err < Max_FFT_Error;
+    int2048_stats::on_guard(!__ok);
+    return __ok;
+}
+
+/**
+ * @brief Load src into __len complex numbers, where each two
+ * points of __digits digits are packed as one (even + odd * i).
+ * @note The rest of the array is cleared.
+ */
+void int2048_base::load_FFT(complex *__cpx, uint2048_view src,
+    std::size_t __len, std::size_t __digits) noexcept {
+    std::memset((void *)__cpx, 0, __len * sizeof(complex));
+    FFT_visit(__digits, [=](auto _Digits) {
+        split_digits <_Digits> (src, [=](std::size_t i, double __val) {
+            if (i & 1) __cpx[i >> 1].imag(__val);
+            else       __cpx[i >> 1].real(__val);
+        });
+    });
+}
+
+/**
+ * @brief Round the result of a packed FFT product of
+ * __len complex numbers, and normalize it to __words words.
+ * @param __parallel Whether to use the thread pool.
+ */
+void int2048_base::unload_FFT(_Iterator __ptr, const complex *__cpx, std::size_t __words,
+    std::size_t __len, std::size_t __digits, bool __parallel) {
+    FFT_visit(__digits, [=](auto _Digits) {
+        carry_pass(__ptr, __words, __parallel, [=](std::size_t i) {
+            return merge_digits <_Digits> (i, [=](std::size_t k) -> _Word_Type {
+                if ((k >> 1) >= __len) return 0;
+                const auto __val = __cpx[k >> 1];
+                return FFT_round(k & 1 ? __val.imag() : __val.real());
+            });
+        });
+    });
+}
+
+/**
+ * @brief Digits per point in the FFT product of __n and __m words.
+ * The error of a product grows with the largest coefficient,
+ * which is about min(__n, __m) * 10^(2 * digits) points, and
+ * with the length of FFT. Packing more digits makes the FFT
+ * shorter, so the most digits within the error bound is taken.
+ */
+std::size_t int2048_base::FFT_digits(std::size_t __n, std::size_t __m) noexcept {
+    /* Worst error measured with all-max words is below 1e-15 * points * 10^(2 * digits). */
+    constexpr double _Scale = 1e-15;
+    constexpr double _Bound = Max_FFT_Error / 2;
+    double __unit = int2048_helper::__pow(_Word_Type {10}, Max_FFT_Digits * 2);
+    for (std::size_t __d = Max_FFT_Digits ; __d != Min_FFT_Digits ; --__d, __unit /= 100) {
+        const double __points = 0.5 * (FFT_points(__n, __d) + FFT_points(__m, __d));
+        if (__points * __unit * _Scale <= _Bound) return __d;
+    } return Min_FFT_Digits;
+}
+
+/**
+ * @brief Multiply a long lhs and a short rhs to __ptr.
+ * lhs is cut into blocks, each multiplied by rhs with a half-length
+ * FFT, where the transform of rhs is done only once and reused.
+ * @param __ptr Output range.
+ * @return Iterator to the tail of the result.
+ * @note lhs should be no shorter than rhs.
+ * Blocks are done from high to low, so that
+ * __ptr may overlap with lhs (but not rhs).
+ */
+auto int2048_base::slice_mul(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs) -> mul_t {
+    static_assert(FFT_Zip == 2, "Wrongly implemented!");
+    int2048_stats::on_call(int2048_stats::kernel::fft_mul, lhs.size());
+    const std::size_t __n = lhs.size();
+    const std::size_t __m = rhs.size();
+    const std::size_t _Length = std::bit_ceil(__m * 2);
+    const std::size_t _Block  = _Length - __m;
+    const auto [__root, __half] = make_plan(_Length);
+
+    FFT_t __rhs, __fft;
+    __rhs.init_capacity(_Length);
+    __fft.init_capacity(_Length);
+    load_FFT(__rhs.begin(), rhs, _Length, FFT_BaseLen);
+    FFT(__rhs.begin(), __root, _Length);
+
+    _Scratch __tmp { _Block + __m };
+    const auto __cpx = __fft.begin();
+    for (std::size_t i = (__n - 1) / _Block * _Block ;; i -= _Block) {
+        const std::size_t __len = std::min(_Block, __n - i);
+        load_FFT(__cpx, {lhs.begin() + i, lhs.begin() + i + __len}, _Length, FFT_BaseLen);
+        FFT(__cpx, __root, _Length);
+        product_FFT(__cpx, __rhs.begin(), __half, _Length, 0, _Length >> 1);
+        IFFT(__cpx, __root, _Length);
+        if (FFT_guard(__cpx, _Length, false))
+            unload_FFT(__tmp.begin(), __cpx, __len + __m, _Length, FFT_BaseLen, false);
+        else
+            ntt_mul(__tmp.begin(), {lhs.begin() + i, lhs.begin() + i + __len}, rhs);
+
+        /* The higher m words overlap with the result of the last block. */
+        if (i + __len == __n) {
+            cpy(__ptr + i, {__tmp.begin(), __tmp.begin() + __len + __m});
+        } else {
+            cpy(__ptr + i, {__tmp.begin(), __tmp.begin() + __len});
+            add_in(__ptr + i + __len, __n - i - __len + __m,
+                {__tmp.begin() + __len, __tmp.begin() + __len + __m});
+        }
+        if (i == 0) break;
     }
 
-    /* Clear the rest of the array. */
-    std::memset((void *)__ptr, 0, (__fft.terminal() - __ptr) * sizeof(complex));
-    return __fft;
+    __ptr += __n + __m;
+    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+    return __ptr;
 }
 
 /* Initialize by a given value. */
@@ -359,171 +1422,156 @@ noexcept -> _Word_Type {
     }
 }
 
-bool int2048_base::use_brute_div(uint2048_view &lhs, uint2048_view &rhs) noexcept {
-    const std::size_t _Delta = lhs.size() - rhs.size();
-    return _Delta == 0 || (_Delta == 1 && *(lhs.end() - 1) < *(rhs.end() - 1));
+/**
+ * @return Whether lhs and rhs should be divided by brute force.
+ * @note Short quotients are still left to newton method, as the
+ * multiplication in adjust_div is much faster than brute force.
+ */
+bool int2048_base::use_brute_div(uint2048_view &, uint2048_view &rhs) noexcept {
+    return rhs.size() < Max_Brute_Div_Length;
 }
 
-auto int2048_base::brute_div(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs)
--> div_t {
-    auto __set_result = [__ptr](_Word_Type __val) -> _Iterator {
-        *__ptr = __val; return __ptr + 1;
-    }; // Simple function to set the result.
-
-    const bool _Delta = lhs.size() - rhs.size();
-    while(*rhs.begin() == 0) ++rhs._beg, ++lhs._beg;
-
-    if (__builtin_expect(_Delta == 0 && lhs.size() == 1, false))
-        return __set_result(*lhs.begin() / *rhs.begin());
-
-    /* Estimate the possible range. */
-    auto [__l , __r] = [=]() -> std::pair <std::size_t,std::size_t> {
-        std::size_t __lhs = *(lhs.end() - 2) + *(lhs.end() - 1) * Base;
-        std::size_t __rhs = *(rhs.end() - 1);
-        if (_Delta == 1) __rhs = __rhs * Base + *(rhs.end() - 2);
-        return { __lhs / (__rhs + 1), __lhs / __rhs + 1};
-    } ();
-
-    /* Now lhs < 2 * rhs, so return 0 or 1. */
-    if (!__l) return __set_result(_Delta || cmp(lhs,rhs).cmp >= 0);
-
-    _Container __buf { lhs.size() }; // Buffer. Maybe it should set static.
-
-    /* Binary search in range [l , r)*/
-    while (__l != __r) {
-        const std::size_t __mid = (__l + __r) >> 1;
-
-        auto __beg = __buf.begin();
-        _Word_Type __carry = 0;
-        for (auto __cur : rhs) {
-            __carry += __cur * __mid;
-            *__beg++ = __carry % Base;
-            __carry /= Base;
+/**
+ * @brief Knuth's algorithm D on a normalized divisor.
+ * Each word of the quotient is estimated by the highest 2 words
+ * of the remainder and the divisor, which is at most 2 too large.
+ * @param __quo Output range, where exactly __len - __den.size() words are written.
+ * @param __num Numerator of __len words, which will be replaced by the remainder.
+ * @param __den Divisor, whose highest word is no less than Base / 2.
+ * @note The highest __den.size() words of __num should be less than __den.
+ */
+void int2048_base::knuth_pass(_Iterator __quo, _Iterator __num, std::size_t __len, uint2048_view __den)
+noexcept {
+    const std::size_t __m = __den.size();
+    const auto __v = __den.begin();
+    const _Word_Type __v1 = __v[__m - 1];
+    const _Word_Type __v2 = __v[__m - 2];
+
+    for (std::size_t j = __len - __m ; j-- != 0 ;) {
+        const auto __u = __num + j;
+        const _Word_Type __top = __u[__m] * Base + __u[__m - 1];
+
+        _Word_Type __q = __top / __v1;
+        _Word_Type __r = __top % __v1;
+        while (__q >= Base || __q * __v2 > __r * Base + __u[__m - 2]) {
+            --__q;
+            if ((__r += __v1) >= Base) break;
         }
 
-        if (_Delta == 0) {
-            if (__carry)  { __r = __mid;     continue; }
-        } else {
-            if (!__carry) { __l = __mid + 1; continue; }
-            *__beg++ = __carry;
+        /**
+         * Multiply and subtract. Each product is split on its own,
+         * so that only a few additions depend on the previous word.
+         * The word never goes below -2 * Base, so at most 2 is borrowed.
+         */
+        using _Signed_Type = std::make_signed_t <_Word_Type>;
+        constexpr auto _Base = static_cast <_Signed_Type> (Base);
+        _Word_Type __carry = 0;
+        for (std::size_t i = 0 ; i != __m ; ++i) {
+            const _Word_Type __prod = __q * __v[i];
+            const _Word_Type __high = __prod / Base;
+            const auto __cur = static_cast <_Signed_Type> (__u[i])
+                - static_cast <_Signed_Type> (__prod - __high * Base)
+                - static_cast <_Signed_Type> (__carry);
+            const _Word_Type __borrow = (__cur < 0) + (__cur < -_Base);
+            __u[i]  = static_cast <_Word_Type> (__cur + static_cast <_Signed_Type> (__borrow) * _Base);
+            __carry = __high + __borrow;
         }
 
-        auto __cmp = cmp({__buf.begin(),__beg} , lhs).cmp;
-        if (__cmp == 0) return __set_result(__mid);
-        else if (__cmp < 0)     __l = __mid + 1;
-        else                    __r = __mid;
-    } return __set_result(__l - 1);
-}
-
-
-} // namespace dark
-
-/* Implementation of FFT base */
-namespace dark {
-
-/**
- * @brief The implementation of FFT.
- * @param __cpx Input complex array, which will be modified.
- * @param __len Length of the array.
- * @note Length of the array should be a power of 2.
- * In addition, the length should be at least 4.
- */
-void FFT_base::FFT(complex * __cpx, std::size_t __len) noexcept {
-    /* Swap accoring to bit-reverse  */
-    for (std::size_t i = 1, j = __len >> 1; i != __len ; ++i) {
-        if (i < j) std::swap(__cpx[i],__cpx[j]);
-        std::size_t k = __len; // Magic!
-        do { k >>= 1; } while ((j ^= k) < k);
-    }
-
-    /* Calculate the unit root. */
-    auto [__table,__bits] = make_table(__len);
-
-    std::size_t i = 1;
-    do { /* Core FFT */
-        --__bits;
-        for (std::size_t j = 0 ; j != __len ; j += (i << 1)) {
-            for (std::size_t k = 0 ; k != i ; ++k) {
-                auto &__lhs = __cpx[j | k];
-                auto &__rhs = __cpx[j | k | i];
-                auto  __tmp = __rhs * __table[k << __bits];
-                __rhs = __lhs - __tmp;
-                __lhs = __lhs + __tmp;
+        /* Too large by 1 (rarely): add the divisor back. */
+        if (__u[__m] < __carry) {
+            --__q;
+            bool __inc = false;
+            for (std::size_t i = 0 ; i != __m ; ++i) {
+                const _Word_Type __sum = __u[i] + __v[i] + __inc;
+                __u[i] = (__inc = __sum > Base - 1) ? __sum - Base : __sum;
             }
         }
-    } while((i <<= 1) != __len);
+
+        __u[__m] = 0;
+        __quo[j] = __q;
+    }
 }
 
 /**
- * @brief Make the root table for FFT.
- * @param __len Length of the root table.
- * @return Custom information struct.
+ * @brief Normalize lhs and rhs into __buf and run knuth_pass.
+ * @param __quo Output range of the quotient.
+ * @return Normalized remainder and the scale of normalization.
+ * @note rhs should be longer than 1 word, and __buf should not be borrowed yet.
  */
-auto FFT_base::make_table(std::size_t __len) -> table_t {
-    using namespace int2048_helper;
-    static vector <complex> __table {};
-    if (__table.size() < __len) {
-        __table.~vector();
-        __table.init_capacity(__len);
-        __table.resize(__len);
-        __table[0] = {1.0, 0.0};
-
-        auto __beg = __table.begin();
-        auto __end = __table.end();
-
-        std::size_t __cnt = 0;
-        const double __delta = 2.0 * std::numbers::pi / __len;
-
-        do { /* Avoid too many function calls. */
-            double __angle = __delta * ++__cnt;
-
-            const double __cos = std::cos(__angle);
-            const double __sin = std::sin(__angle);
-
-            *++__beg = {__cos, __sin};
-            *--__end = {__cos,-__sin};
-        } while (__beg != __end);
-
-        *__beg = {-1.0 , 0.0}; // cos(pi), sin(pi)
+auto int2048_base::knuth_div(_Iterator __quo, _Scratch &__buf, uint2048_view lhs, uint2048_view rhs)
+-> std::pair <_Iterator, _Word_Type> {
+    const std::size_t __n = lhs.size();
+    const std::size_t __m = rhs.size();
+    const _Word_Type __scale = Base / (*(rhs.end() - 1) + 1);
+
+    __buf.init_capacity(__n + 1 + (__scale != 1 ? __m : 0));
+    const auto __num = __buf.begin();
+    __num[__n] = mul_small(__num, lhs, __scale);
+    if (__scale != 1) {
+        const auto __den = __num + (__n + 1);
+        mul_small(__den, rhs, __scale);
+        rhs = { __den, __den + __m };
     }
 
-    return {__table.begin(), __log2(__table.size())};
+    knuth_pass(__quo, __num, __n + 1, rhs);
+    return { __num, __scale };
 }
 
 /**
- * @brief Merge the result of 2 FFT.
- * @param __beg Begin of the array.
- * @param __end End of the array.
+ * @brief Divide lhs by rhs to __ptr by brute force.
+ * @return Iterator to the tail of the quotient.
  */
-inline void FFT_base::merge_FFT(complex *__beg, complex *__end) noexcept {
-    const double __mul = 0.5 / (__end - __beg);
-    while (__beg != __end) {
-        auto &__cur = *__beg++;
-        __cur = (__cur * __cur) * __mul;
+auto int2048_base::brute_div(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs)
+-> div_t {
+    int2048_stats::on_call(int2048_stats::kernel::brute_div, lhs.size());
+    const std::size_t _Length = lhs.size() - rhs.size() + 1;
+    if (rhs.size() == 1) {
+        div_small(__ptr, lhs, *rhs.begin());
+    } else {
+        _Scratch __buf {};
+        knuth_div(__ptr, __buf, lhs, rhs);
     }
+
+    __ptr += _Length;
+    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+    return __ptr;
 }
 
 /**
- * @brief Do the work of IFFT to a given array.
- * @param __beg Begin of the array.
- * @param __end End of the array.
+ * @brief Work out lhs mod rhs to __ptr by brute force.
+ * @return Iterator to the tail of the remainder.
  */
-inline void FFT_base::final_FFT(complex *__beg, complex *__end) noexcept {
-    while (++__beg != --__end) std::swap(*__beg , *__end);
+auto int2048_base::brute_mod(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs)
+-> mod_t {
+    _Scratch __quo { lhs.size() };
+    return brute_divmod(__quo.begin(), __ptr, lhs, rhs).second;
 }
 
-
 /**
- * @brief A pass through all things to do in FFT.
- * @param __fft FFT array generated by make_FFT.
+ * @brief Divide lhs by rhs by brute force, with both the quotient and remainder.
+ * @return Iterator to the tail of the quotient and the remainder.
  */
-inline void FFT_base::FFT_pass(FFT_t &__fft) noexcept {
-    FFT (__fft.begin(), __fft.capacity());
-    merge_FFT(__fft.begin(), __fft.terminal());
-    FFT (__fft.begin(), __fft.capacity());
-    final_FFT(__fft.begin(), __fft.terminal());
-}
+auto int2048_base::brute_divmod(_Iterator __quo, _Iterator __rem, uint2048_view lhs, uint2048_view rhs)
+-> std::pair <_Iterator, _Iterator> {
+    int2048_stats::on_call(int2048_stats::kernel::brute_div, lhs.size());
+    const std::size_t __m = rhs.size();
+    auto __tail = __quo + (lhs.size() - __m + 1);
+    if (__m == 1) {
+        const _Word_Type __rest = div_small(__quo, lhs, *rhs.begin());
+        if (__tail[-1] == 0) --__tail; // Remove the leading 0.
+        if (__rest != 0) *__rem++ = __rest;
+        return { __tail, __rem };
+    }
 
+    _Scratch __buf {};
+    const auto [__num, __scale] = knuth_div(__quo, __buf, lhs, rhs);
+    div_small(__rem, {__num, __num + __m}, __scale);
+    if (__tail[-1] == 0) --__tail; // Remove the leading 0.
+
+    auto __end = __rem + __m;
+    while (__end != __rem && __end[-1] == 0) --__end; // Remove the leading 0s.
+    return { __tail, __end };
+}
 
 } // namespace dark
 
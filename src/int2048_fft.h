@@ -0,0 +1,752 @@
+#pragma once
+
+#include "int2048.h"
+#include <numbers>
+
+/* Implementation of FFT base. */
+namespace dark {
+
+/* Complex multiplication, without the inf/nan checks of std::complex. */
+inline auto FFT_base::cmul(complex __x, complex __y) noexcept -> complex {
+    return {
+        __x.real() * __y.real() - __x.imag() * __y.imag(),
+        __x.real() * __y.imag() + __x.imag() * __y.real()
+    };
+}
+
+/**
+ * @brief Round a result of FFT to the nearest integer.
+ * @note This is much faster than std::llround, but it requires that
+ * the exact result is a non-negative integer below 2^63 and the
+ * error is less than 0.5, which is always true for FFT products.
+ */
+inline auto FFT_base::FFT_round(double __x) noexcept -> std::int64_t {
+    return static_cast <std::int64_t> (__x + 0.5);
+}
+
+/**
+ * @brief Radix-4 butterflies of forward FFT, where
+ * two radix-2 levels (of 4q and 2q) are merged into one.
+ * @param __cpx Input complex array, which will be modified.
+ * @param __root Root table from make_plan.
+ * @param q Quarter of the block length.
+ * @param __beg Index of the first butterfly to do.
+ * @param __end Index of the last butterfly to do (exclusive).
+ * @note There are __len / 4 butterflies in total, and
+ * butterfly (j * q + k) works on block j at offset k.
+ */
+void FFT_base::FFT_level(complex *__cpx, const complex *__root, std::size_t q,
+    std::size_t __beg, std::size_t __end) noexcept {
+    const complex *__unit1 = __root + q * 2;
+    const complex *__unit2 = __root + q;
+    while (__beg != __end) {
+        complex *__ptr = __cpx + __beg / q * q * 4;
+        std::size_t k = __beg % q;
+        const std::size_t __last = std::min(q, k + (__end - __beg));
+        __beg += __last - k;
+        for (; k != __last ; ++k) {
+            const auto __w1 = __unit1[k];
+            const auto __w2 = __unit2[k];
+            const auto __w3 = cmul(__w1, __w2);
+            const auto __a0 = __ptr[k];
+            const auto __a1 = __ptr[k + q];
+            const auto __a2 = __ptr[k + q * 2];
+            const auto __a3 = __ptr[k + q * 3];
+            const auto __b0 = __a0 + __a2;
+            const auto __b1 = __a1 + __a3;
+            const auto __d  = __a0 - __a2;
+            const auto __e  = __a1 - __a3;
+            const auto __ie = complex(-__e.imag(), __e.real());
+            __ptr[k]         = __b0 + __b1;
+            __ptr[k + q]     = cmul(__b0 - __b1, __w2);
+            __ptr[k + q * 2] = cmul(__d + __ie, __w1);
+            __ptr[k + q * 3] = cmul(__d - __ie, __w3);
+        }
+    }
+}
+
+/**
+ * @brief Radix-4 butterflies of inverse FFT, which is
+ * exactly the reverse of FFT_level, with conjugate roots.
+ * @note Parameters are the same as FFT_level.
+ */
+void FFT_base::IFFT_level(complex *__cpx, const complex *__root, std::size_t q,
+    std::size_t __beg, std::size_t __end) noexcept {
+    const complex *__unit1 = __root + q * 2;
+    const complex *__unit2 = __root + q;
+    while (__beg != __end) {
+        complex *__ptr = __cpx + __beg / q * q * 4;
+        std::size_t k = __beg % q;
+        const std::size_t __last = std::min(q, k + (__end - __beg));
+        __beg += __last - k;
+        for (; k != __last ; ++k) {
+            const auto __w1 = std::conj(__unit1[k]);
+            const auto __w2 = std::conj(__unit2[k]);
+            const auto __w3 = cmul(__w1, __w2);
+            const auto __t0 = __ptr[k];
+            const auto __t1 = cmul(__ptr[k + q]    , __w2);
+            const auto __t2 = cmul(__ptr[k + q * 2], __w1);
+            const auto __t3 = cmul(__ptr[k + q * 3], __w3);
+            const auto __b0 = __t0 + __t1;
+            const auto __b1 = __t0 - __t1;
+            const auto __s  = __t2 + __t3;
+            const auto __d  = __t2 - __t3;
+            const auto __id = complex(__d.imag(), -__d.real());
+            __ptr[k]         = __b0 + __s;
+            __ptr[k + q]     = __b1 + __id;
+            __ptr[k + q * 2] = __b0 - __s;
+            __ptr[k + q * 3] = __b1 - __id;
+        }
+    }
+}
+
+#if defined(__AVX2__)
+
+/**
+ * @brief Split __len complex numbers into the real and imaginary parts.
+ * Each group of 4 is stored in the order of 0, 2, 1, 3, which saves a
+ * shuffle. It does not matter, since the butterflies never mix the
+ * lanes, and the roots from split_root are in the same order.
+ * @note __len should be a multiple of 4.
+ */
+void FFT_base::split_t::load(const complex *__cpx, std::size_t __len) noexcept {
+    const double *__src = reinterpret_cast <const double *> (__cpx);
+    for (std::size_t i = 0 ; i != __len ; i += 4) {
+        const __m256d __lo = _mm256_loadu_pd(__src + i * 2);
+        const __m256d __hi = _mm256_loadu_pd(__src + i * 2 + 4);
+        _mm256_store_pd(re + i, _mm256_unpacklo_pd(__lo, __hi));
+        _mm256_store_pd(im + i, _mm256_unpackhi_pd(__lo, __hi));
+    }
+}
+
+/* Merge the parts back to __len complex numbers, which is the reverse of load. */
+void FFT_base::split_t::store(complex *__cpx, std::size_t __len) const noexcept {
+    double *__dst = reinterpret_cast <double *> (__cpx);
+    for (std::size_t i = 0 ; i != __len ; i += 4) {
+        const __m256d __re = _mm256_load_pd(re + i);
+        const __m256d __im = _mm256_load_pd(im + i);
+        _mm256_storeu_pd(__dst + i * 2,     _mm256_unpacklo_pd(__re, __im));
+        _mm256_storeu_pd(__dst + i * 2 + 4, _mm256_unpackhi_pd(__re, __im));
+    }
+}
+
+/* Load 4 roots, in the same order as split_t::load. */
+inline auto FFT_base::split_root(const complex *__root) noexcept -> vcomplex {
+    const double *__src = reinterpret_cast <const double *> (__root);
+    const __m256d __lo = _mm256_loadu_pd(__src);
+    const __m256d __hi = _mm256_loadu_pd(__src + 4);
+    return { _mm256_unpacklo_pd(__lo, __hi), _mm256_unpackhi_pd(__lo, __hi) };
+}
+
+/* Complex multiplication of 4 pairs. */
+inline auto FFT_base::cmul(vcomplex __x, vcomplex __y) noexcept -> vcomplex {
+    return {
+        _mm256_sub_pd(_mm256_mul_pd(__x.re, __y.re), _mm256_mul_pd(__x.im, __y.im)),
+        _mm256_add_pd(_mm256_mul_pd(__x.re, __y.im), _mm256_mul_pd(__x.im, __y.re))
+    };
+}
+
+/* Multiply __x by the conjugate of __y, for 4 pairs. */
+inline auto FFT_base::cmul_conj(vcomplex __x, vcomplex __y) noexcept -> vcomplex {
+    return {
+        _mm256_add_pd(_mm256_mul_pd(__x.re, __y.re), _mm256_mul_pd(__x.im, __y.im)),
+        _mm256_sub_pd(_mm256_mul_pd(__x.im, __y.re), _mm256_mul_pd(__x.re, __y.im))
+    };
+}
+
+/**
+ * @brief Radix-4 levels of forward FFT on a block within cache, with AVX2.
+ * The block is split into the real and imaginary parts, so that each
+ * register holds 4 butterflies (offsets k to k + 3) of the same level.
+ * @param __len Length of the block, at most 2^FFT_Block.
+ * @return Length of the sub-blocks left, which is less than 16.
+ * Their levels have fewer than 4 butterflies in a row, and are left to
+ * FFT_level and the radix-2 level.
+ * @note The result is the same as FFT_level on these levels.
+ */
+std::size_t FFT_base::FFT_split(complex *__cpx, const complex *__root, std::size_t __len) noexcept {
+    if (__len < 16) return __len;
+    split_t __buf;
+    __buf.load(__cpx, __len);
+
+    std::size_t i = __len;
+    for (; i >= 16 ; i >>= 2) {
+        const std::size_t q = i >> 2;
+        const complex *__unit1 = __root + q * 2;
+        const complex *__unit2 = __root + q;
+        for (std::size_t k = 0 ; k != q ; k += 4) {
+            const auto __w1 = split_root(__unit1 + k);
+            const auto __w2 = split_root(__unit2 + k);
+            const auto __w3 = cmul(__w1, __w2);
+            for (std::size_t j = k ; j < __len ; j += i) {
+                const auto __a0 = __buf.get(j);
+                const auto __a1 = __buf.get(j + q);
+                const auto __a2 = __buf.get(j + q * 2);
+                const auto __a3 = __buf.get(j + q * 3);
+                const auto __b0 = __a0 + __a2;
+                const auto __b1 = __a1 + __a3;
+                const auto __d  = __a0 - __a2;
+                const auto __e  = __a1 - __a3;
+                /* d + ie and d - ie. */
+                const vcomplex __p { _mm256_sub_pd(__d.re, __e.im), _mm256_add_pd(__d.im, __e.re) };
+                const vcomplex __m { _mm256_add_pd(__d.re, __e.im), _mm256_sub_pd(__d.im, __e.re) };
+                __buf.set(j,         __b0 + __b1);
+                __buf.set(j + q,     cmul(__b0 - __b1, __w2));
+                __buf.set(j + q * 2, cmul(__p, __w1));
+                __buf.set(j + q * 3, cmul(__m, __w3));
+            }
+        }
+    }
+
+    __buf.store(__cpx, __len);
+    return i;
+}
+
+/**
+ * @brief Radix-4 levels of inverse FFT on a block within cache, with AVX2,
+ * from the level of sub-block length 4i up to the whole block.
+ * @param __len Length of the block, at most 2^FFT_Block.
+ * @param i Quarter of the first level, at least 4.
+ * @note The result is the same as IFFT_level on these levels.
+ */
+void FFT_base::IFFT_split(complex *__cpx, const complex *__root, std::size_t __len, std::size_t i) noexcept {
+    split_t __buf;
+    __buf.load(__cpx, __len);
+
+    for (; i != __len ; i <<= 2) {
+        const std::size_t q = i;
+        const complex *__unit1 = __root + q * 2;
+        const complex *__unit2 = __root + q;
+        for (std::size_t k = 0 ; k != q ; k += 4) {
+            const auto __w1 = split_root(__unit1 + k);
+            const auto __w2 = split_root(__unit2 + k);
+            const auto __w3 = cmul(__w1, __w2);
+            for (std::size_t j = k ; j < __len ; j += q * 4) {
+                const auto __t0 = __buf.get(j);
+                const auto __t1 = cmul_conj(__buf.get(j + q),     __w2);
+                const auto __t2 = cmul_conj(__buf.get(j + q * 2), __w1);
+                const auto __t3 = cmul_conj(__buf.get(j + q * 3), __w3);
+                const auto __b0 = __t0 + __t1;
+                const auto __b1 = __t0 - __t1;
+                const auto __s  = __t2 + __t3;
+                const auto __d  = __t2 - __t3;
+                __buf.set(j,         __b0 + __s);
+                __buf.set(j + q * 2, __b0 - __s);
+                /* b1 - id and b1 + id. */
+                __buf.set(j + q,     { _mm256_add_pd(__b1.re, __d.im), _mm256_sub_pd(__b1.im, __d.re) });
+                __buf.set(j + q * 3, { _mm256_sub_pd(__b1.re, __d.im), _mm256_add_pd(__b1.im, __d.re) });
+            }
+        }
+    }
+
+    __buf.store(__cpx, __len);
+}
+
+#endif
+
+/**
+ * @brief Forward FFT (decimation in frequency), with radix-4 butterflies.
+ * @param __cpx Input complex array, which will be modified.
+ * @param __root Root table from make_plan.
+ * @param __len Length of the array (a power of 2).
+ * @note The output is in bit-reversed order, which
+ * is exactly what IFFT requires as input.
+ * Long arrays are transformed depth-first, so that
+ * each block of 2^FFT_Block is done within cache.
+ * With AVX2, the levels of such blocks go to FFT_split.
+ */
+void FFT_base::FFT(complex *__cpx, const complex *__root, std::size_t __len) noexcept {
+    std::size_t i = __len;
+#if defined(__AVX2__)
+    if (__len <= (std::size_t {1} << FFT_Block)) i = FFT_split(__cpx, __root, __len);
+#endif
+    while (i >= 4) {
+        FFT_level(__cpx, __root, i >> 2, 0, __len >> 2);
+        i >>= 2;
+
+        /* The quarters are independent from now on. */
+        if (__len > (std::size_t {1} << FFT_Block)) {
+            for (std::size_t j = 0 ; j != __len ; j += i) FFT(__cpx + j, __root, i);
+            return;
+        }
+    }
+
+    /* The last radix-2 level, if any. */
+    if (i == 2)
+        for (std::size_t j = 0 ; j != __len ; j += 2) {
+            const auto __x = __cpx[j];
+            const auto __y = __cpx[j + 1];
+            __cpx[j]     = __x + __y;
+            __cpx[j + 1] = __x - __y;
+        }
+}
+
+/**
+ * @brief Inverse FFT (decimation in time), without the 1/n factor.
+ * @param __cpx Input complex array in bit-reversed order, which will be modified.
+ * @param __root Root table from make_plan.
+ * @param __len Length of the array (a power of 2).
+ * @note This is exactly the reverse of FFT, with conjugate roots.
+ */
+void FFT_base::IFFT(complex *__cpx, const complex *__root, std::size_t __len) noexcept {
+    std::size_t i = 1;
+    if (__len > (std::size_t {1} << FFT_Block)) {
+        /* The quarters are independent until the last level. */
+        const std::size_t q = __len >> 2;
+        for (std::size_t j = 0 ; j != __len ; j += q) IFFT(__cpx + j, __root, q);
+        i = q;
+    } else if (std::countr_zero(__len) & 1) {
+        /* The first radix-2 level. */
+        for (std::size_t j = 0 ; j != __len ; j += 2) {
+            const auto __x = __cpx[j];
+            const auto __y = __cpx[j + 1];
+            __cpx[j]     = __x + __y;
+            __cpx[j + 1] = __x - __y;
+        }
+        i = 2;
+    }
+
+    for (; i != __len ; i <<= 2) {
+#if defined(__AVX2__)
+        if (i >= 4 && __len <= (std::size_t {1} << FFT_Block))
+            return IFFT_split(__cpx, __root, __len, i);
+#endif
+        IFFT_level(__cpx, __root, i, 0, __len >> 2);
+    }
+}
+
+/**
+ * @brief Forward FFT with the thread pool.
+ * Top levels are split by butterflies, until there are
+ * enough independent blocks for all the threads.
+ * @note The result is the same as FFT.
+ */
+void FFT_base::parallel_FFT(complex *__cpx, const complex *__root, std::size_t __len) noexcept {
+    using int2048_helper::parallel;
+    std::size_t i = __len;
+    for (; i >= 4 && __len / i < parallel::width() ; i >>= 2)
+        parallel::split(__len >> 2, [=](std::size_t __beg, std::size_t __end) {
+            FFT_level(__cpx, __root, i >> 2, __beg, __end);
+        });
+
+    parallel::split(__len / i, [=](std::size_t __beg, std::size_t __end) {
+        for (std::size_t j = __beg ; j != __end ; ++j) FFT(__cpx + j * i, __root, i);
+    });
+}
+
+/**
+ * @brief Inverse FFT with the thread pool.
+ * @note The result is the same as IFFT.
+ */
+void FFT_base::parallel_IFFT(complex *__cpx, const complex *__root, std::size_t __len) noexcept {
+    using int2048_helper::parallel;
+    std::size_t i = __len;
+    while (i >= 4 && __len / i < parallel::width()) i >>= 2;
+
+    parallel::split(__len / i, [=](std::size_t __beg, std::size_t __end) {
+        for (std::size_t j = __beg ; j != __end ; ++j) IFFT(__cpx + j * i, __root, i);
+    });
+
+    for (; i != __len ; i <<= 2)
+        parallel::split(__len >> 2, [=](std::size_t __beg, std::size_t __end) {
+            IFFT_level(__cpx, __root, i, __beg, __end);
+        });
+}
+
+/* Free all the tables, which are no longer used at exit. */
+FFT_base::table_cache::~table_cache() noexcept {
+    for (const table_t *__cur = head.load() ; __cur != nullptr ; )
+        delete std::exchange(__cur, __cur->prev);
+}
+
+/**
+ * @brief Get a table for length __len, which is built by __func(table)
+ * if no published one is long enough. A new table is built under the
+ * lock and then published, while the older ones are kept, so readers
+ * of any table need no lock at all.
+ * @return The longest table, whose size is at least __len.
+ */
+template <typename _Func>
+auto FFT_base::table_cache::get(std::size_t __len, _Func &&__func) -> const table_t * {
+    const table_t *__cur = head.load(std::memory_order_acquire);
+    if (__cur != nullptr && __cur->size >= __len) return __cur;
+
+    std::lock_guard __guard {lock};
+    __cur = head.load(std::memory_order_relaxed);
+    if (__cur != nullptr && __cur->size >= __len) return __cur;
+
+    std::unique_ptr <table_t> __next { new table_t {__len, __cur, {}} };
+    __func(*__next);
+    head.store(__next.get(), std::memory_order_release);
+    return __next.release();
+}
+
+/**
+ * @brief Make the plan (twiddle factors) for FFT.
+ * Since the layout of the tables does not depend on the length,
+ * the plan of a longer FFT can be used by any shorter one.
+ * So only the plan for the longest FFT is used, and a longer
+ * one just copies it and adds the levels above.
+ * @param __len Length of the FFT (a power of 2).
+ * @return Custom information struct.
+ * @note It can be called by many threads at the same time.
+ */
+auto FFT_base::make_plan(std::size_t __len) -> plan_t {
+    static table_cache __cache {};
+    __len = std::max <std::size_t> (__len, 2);
+
+    /* Roots for FFT in [0, __len), and those for product_FFT in [__len, 2 * __len). */
+    const table_t *__table = __cache.get(__len, [](table_t &__table) {
+        const std::size_t __len = __table.size;
+        __table.data.init_capacity(__len * 2);
+        __table.data.resize(__len * 2);
+        const auto __root = __table.data.begin();
+        const auto __half = __root + __len;
+
+        std::size_t __old = 2;
+        if (const table_t *__prev = __table.prev) {
+            __old = __prev->size;
+            std::memcpy((void *)__root, __prev->data.begin(), __old * sizeof(complex));
+            std::memcpy((void *)__half, __prev->data.begin() + __old, __old * sizeof(complex));
+        } else {
+            __root[0] = __root[1] = {1.0, 0.0};
+            __half[0] = {1.0, 0.0};
+            __half[1] = {-1.0, 0.0};
+        }
+
+        /**
+         * Level h (in [h, 2h)) holds w_{2h}^i. The even terms are just those
+         * of the level below, so only the odd ones are calculated. The angle
+         * is worked out in extended precision before rounded to double.
+         */
+        for (std::size_t h = __old ; h != __len ; h <<= 1) {
+            const long double __delta = std::numbers::pi_v <long double> / h;
+            for (std::size_t i = 0 ; i != h ; i += 2) {
+                __root[h + i]     = __root[(h >> 1) + (i >> 1)];
+                __root[h + i + 1] = std::polar(1.0, static_cast <double> (__delta * (i + 1)));
+            }
+        }
+
+        /**
+         * In bit-reversed order, position 2^j + i holds the
+         * frequency of odd multiple 2 * rev(i) + 1 of 2^-(j+1).
+         * So its root is w_{2^(j+1)}^{2 * rev(i) + 1}, which is
+         * in the level 2^j of roots (negated if t >= 2^j).
+         */
+        for (std::size_t j = __old ; j != __len ; j <<= 1) {
+            for (std::size_t i = 0, r = 0 ; i != j ; ++i) {
+                const std::size_t t = r << 1 | 1;
+                __half[j + i] = t < j ? __root[j + t] : -__root[t];
+                /* Increase r in bit-reversed order. */
+                std::size_t k = j;
+                do { k >>= 1; } while (k && (r ^= k) < k);
+            }
+        }
+    });
+
+    return {__table->data.begin(), __table->data.begin() + __table->size};
+}
+
+/**
+ * @brief Make the roots for the radix-r level of FFT of length r * M.
+ * Level M of the table (in [M, 2M)) holds w^t (t in [0, M)) of order
+ * r * M. Like make_plan, a longer table just adds the levels above,
+ * where the even terms are those of the level below.
+ * @param _Radix 3 or 5.
+ * @param __len M, the length of each block (a power of 2, at least 2).
+ * @return Roots w^t (t in [0, M)) of order r * M.
+ * @note It can be called by many threads at the same time.
+ */
+auto FFT_base::make_mixed(std::size_t _Radix, std::size_t __len) -> mixed_t {
+    static table_cache __cache[2] {};
+    const table_t *__table = __cache[_Radix == 5].get(__len * 2, [_Radix](table_t &__table) {
+        const std::size_t __size = __table.size;
+        __table.data.init_capacity(__size);
+        __table.data.resize(__size);
+        const auto __unit = __table.data.begin();
+
+        std::size_t __old = 2;
+        if (const table_t *__prev = __table.prev) {
+            __old = __prev->size;
+            std::memcpy((void *)__unit, __prev->data.begin(), __old * sizeof(complex));
+        } else {
+            __unit[0] = __unit[1] = {1.0, 0.0};
+        }
+
+        for (std::size_t m = __old ; m != __size ; m <<= 1) {
+            const long double __delta = 2 * std::numbers::pi_v <long double> / (_Radix * m);
+            for (std::size_t t = 0 ; t != m ; t += 2) {
+                __unit[m + t]     = __unit[(m >> 1) + (t >> 1)];
+                __unit[m + t + 1] = std::polar(1.0, static_cast <double> (__delta * (t + 1)));
+            }
+        }
+    });
+
+    return __table->data.begin() + __len;
+}
+
+/**
+ * @brief Radix-r level of FFT of length r * M, which is the first
+ * level of forward FFT (decimation in frequency) or the last one of
+ * inverse FFT (decimation in time), without the 1/n factor.
+ * After the forward one, block j (at [j * M, (j + 1) * M)) is left to
+ * a FFT of length M, whose k-th frequency is the (r * k + j)-th of all.
+ * @param __unit Roots from make_mixed.
+ * @param __len M, the length of each block.
+ * @param __beg Index of the first butterfly to do.
+ * @param __end Index of the last butterfly to do (exclusive).
+ */
+template <std::size_t _Radix, bool _Inverse>
+void FFT_base::FFT_radix(complex *__cpx, mixed_t __unit, std::size_t __len,
+    std::size_t __beg, std::size_t __end) noexcept {
+    static_assert(_Radix == 3 || _Radix == 5, "Wrongly implemented!");
+    /* Multiply by i (or -i for inverse). */
+    auto __rotate = [](complex __x) -> complex {
+        if constexpr (_Inverse) return { __x.imag(), -__x.real() };
+        else                    return {-__x.imag(),  __x.real() };
+    };
+
+    for (std::size_t t = __beg ; t != __end ; ++t) {
+        complex __a[_Radix];
+        complex __w[_Radix];
+        __w[0] = 1;
+        __w[1] = __unit[t];
+        for (std::size_t j = 2 ; j != _Radix ; ++j) __w[j] = cmul(__w[j - 1], __w[1]);
+        if constexpr (_Inverse)
+            for (std::size_t j = 1 ; j != _Radix ; ++j) __w[j] = std::conj(__w[j]);
+
+        for (std::size_t j = 0 ; j != _Radix ; ++j) __a[j] = __cpx[t + j * __len];
+        if constexpr (_Inverse)
+            for (std::size_t j = 1 ; j != _Radix ; ++j) __a[j] = cmul(__a[j], __w[j]);
+
+        complex __b[_Radix];
+        if constexpr (_Radix == 3) {
+            /* w3 = -1/2 + i * sqrt(3)/2 */
+            constexpr double _Sin = 0.86602540378443864676;
+            const auto __s = __a[1] + __a[2];
+            const auto __d = __rotate(__a[1] - __a[2]) * _Sin;
+            const auto __t = __a[0] - __s * 0.5;
+            __b[0] = __a[0] + __s;
+            __b[1] = __t + __d;
+            __b[2] = __t - __d;
+        } else {
+            /* w5 = cos(2pi/5) + i * sin(2pi/5) */
+            constexpr double _Cos1 = 0.30901699437494742410;
+            constexpr double _Cos2 = -0.80901699437494742410;
+            constexpr double _Sin1 = 0.95105651629515357212;
+            constexpr double _Sin2 = 0.58778525229247312917;
+            const auto __s1 = __a[1] + __a[4];
+            const auto __d1 = __rotate(__a[1] - __a[4]);
+            const auto __s2 = __a[2] + __a[3];
+            const auto __d2 = __rotate(__a[2] - __a[3]);
+            const auto __t1 = __a[0] + __s1 * _Cos1 + __s2 * _Cos2;
+            const auto __t2 = __a[0] + __s1 * _Cos2 + __s2 * _Cos1;
+            const auto __u1 = __d1 * _Sin1 + __d2 * _Sin2;
+            const auto __u2 = __d1 * _Sin2 - __d2 * _Sin1;
+            __b[0] = __a[0] + __s1 + __s2;
+            __b[1] = __t1 + __u1;
+            __b[4] = __t1 - __u1;
+            __b[2] = __t2 + __u2;
+            __b[3] = __t2 - __u2;
+        }
+
+        if constexpr (!_Inverse)
+            for (std::size_t j = 1 ; j != _Radix ; ++j) __b[j] = cmul(__b[j], __w[j]);
+        for (std::size_t j = 0 ; j != _Radix ; ++j) __cpx[t + j * __len] = __b[j];
+    }
+}
+
+/**
+ * @brief Run the radix-r level of FFT on all the butterflies.
+ * @param __parallel Whether to use the thread pool.
+ */
+template <bool _Inverse>
+void FFT_base::mixed_level(complex *__cpx, std::size_t _Radix, std::size_t __len, bool __parallel) {
+    using int2048_helper::parallel;
+    const auto __unit = make_mixed(_Radix, __len);
+    auto __pass = [=](std::size_t __beg, std::size_t __end) {
+        if (_Radix == 3) FFT_radix <3, _Inverse> (__cpx, __unit, __len, __beg, __end);
+        else             FFT_radix <5, _Inverse> (__cpx, __unit, __len, __beg, __end);
+    };
+    if (__parallel) parallel::split(__len, __pass);
+    else            __pass(0, __len);
+}
+
+/**
+ * @brief Forward FFT of any length from FFT_length.
+ * @param __len Length of the array, which is r * 2^k (r = 1, 3, 5).
+ * @param __parallel Whether to use the thread pool.
+ * @note The output is in the order of mixed_IFFT and product_FFT.
+ */
+void FFT_base::mixed_FFT(complex *__cpx, std::size_t __len, bool __parallel) {
+    const std::size_t _Block = std::size_t {1} << std::countr_zero(__len);
+    const std::size_t _Radix = __len / _Block;
+    if (_Radix != 1) mixed_level <false> (__cpx, _Radix, _Block, __parallel);
+
+    const auto __root = make_plan(_Block).root;
+    for (std::size_t j = 0 ; j != __len ; j += _Block) {
+        if (__parallel) parallel_FFT(__cpx + j, __root, _Block);
+        else            FFT(__cpx + j, __root, _Block);
+    }
+}
+
+/**
+ * @brief Inverse FFT of any length from FFT_length, without the 1/n factor.
+ * @note This is exactly the reverse of mixed_FFT, with conjugate roots.
+ */
+void FFT_base::mixed_IFFT(complex *__cpx, std::size_t __len, bool __parallel) {
+    const std::size_t _Block = std::size_t {1} << std::countr_zero(__len);
+    const std::size_t _Radix = __len / _Block;
+
+    const auto __root = make_plan(_Block).root;
+    for (std::size_t j = 0 ; j != __len ; j += _Block) {
+        if (__parallel) parallel_IFFT(__cpx + j, __root, _Block);
+        else            IFFT(__cpx + j, __root, _Block);
+    }
+
+    if (_Radix != 1) mixed_level <true> (__cpx, _Radix, _Block, __parallel);
+}
+
+/**
+ * @brief Choose the length of FFT for at least __len points.
+ * Besides powers of 2, 3 * 2^k and 5 * 2^k are also allowed,
+ * so that the length will not almost double at the boundary.
+ * The radix-r level is counted as FFT_Radix_Cost levels of radix-2.
+ * @note The length is at least 4.
+ */
+std::size_t FFT_base::FFT_length(std::size_t __len) noexcept {
+    __len = std::max <std::size_t> (__len, 4);
+    std::size_t __best = std::bit_ceil(__len);
+    double __cost = __best * double(std::bit_width(__best));
+    for (const std::size_t _Radix : {3, 5}) {
+        const std::size_t _Block = std::bit_ceil((__len + _Radix - 1) / _Radix);
+        if (_Block < 4) continue;
+        const std::size_t __cur = _Block * _Radix;
+        const double __now = __cur * (std::bit_width(_Block) + FFT_Radix_Cost[_Radix == 5]);
+        if (__now < __cost) __best = __cur, __cost = __now;
+    } return __best;
+}
+
+/**
+ * @brief Multiply one pair of the spectra of 2 real sequences packed in halves.
+ * If z = x_even + x_odd * i, then X_k = E_k + w^k O_k, where w
+ * is the unit root of order 2 * __len, and
+ * E_k = (Z_k + conj Z_-k) / 2 and O_k = (Z_k - conj Z_-k) / 2i.
+ * The product is packed back as Ex Ey + w^2k Ox Oy + i (Ex Oy + Ox Ey).
+ * @param i Position of Z_k.
+ * @param j Position of Z_-k.
+ * @param __wi Root w^2k for position i.
+ * @param __wj Root w^-2k for position j.
+ * @param __mul The factor of IFFT.
+ */
+inline void FFT_base::product_pair(complex *__lhs, const complex *__rhs, std::size_t i, std::size_t j,
+    complex __wi, complex __wj, double __mul) noexcept {
+    /* Split Z_k into E_k and O_k. */
+    auto __split = [](const complex *__cpx, std::size_t i, std::size_t j) {
+        const complex __x = __cpx[i];
+        const complex __y = std::conj(__cpx[j]);
+        return std::pair { (__x + __y) * 0.5, cmul(__x - __y, {0, -0.5}) };
+    };
+
+    const auto [__ex, __ox] = __split(__lhs, i, j);
+    const auto [__ey, __oy] = __split(__rhs, i, j);
+
+    /* The pair (j, i) is just the conjugate of (i, j). */
+    auto __merge = [](complex __ex, complex __ox, complex __ey, complex __oy, complex __w) {
+        const complex __cross = cmul(__ex, __oy) + cmul(__ox, __ey);
+        return cmul(__ex, __ey) + cmul(__w, cmul(__ox, __oy)) + complex(-__cross.imag(), __cross.real());
+    };
+
+    __lhs[i] = __merge(__ex, __ox, __ey, __oy, __wi) * __mul;
+    __lhs[j] = __merge(std::conj(__ex), std::conj(__ox),
+                       std::conj(__ey), std::conj(__oy), __wj) * __mul;
+}
+
+/**
+ * @brief Multiply the spectra of 2 real sequences packed in halves.
+ * See product_pair for the details.
+ * @param __lhs Spectrum of lhs from mixed_FFT, which will be the result.
+ * @param __rhs Spectrum of rhs from mixed_FFT. It may be the same as __lhs.
+ * @param __half Twiddle table (w^2k in bit-reversed order) from make_plan.
+ * @param __len Length of the array (at least 2), which is r * 2^k (r = 1, 3, 5).
+ * @param __beg Index of the first pair to multiply.
+ * @param __end Index of the last pair to multiply (exclusive).
+ * @note The 1/n factor of IFFT is also multiplied.
+ * In bit-reversed order, Z_k and Z_-k are mirrored in [2^j, 2^(j+1)).
+ * There are __len / 2 pairs in total, where pair 0 is (0, 0) and (1, 1).
+ * For mixed radix, block 0 is paired within itself just like above,
+ * and position p of block j is paired with position M - 1 - p of
+ * block r - j, whose pairs follow those of block 0.
+ */
+inline void FFT_base::product_FFT(complex *__lhs, const complex *__rhs, const complex *__half,
+    std::size_t __len, std::size_t __beg, std::size_t __end) noexcept {
+    const double __mul = 1.0 / __len;
+    const std::size_t _Radix = __len >> std::countr_zero(__len);
+    const std::size_t _Block = __len / _Radix;
+
+    const std::size_t __last = std::min(__end, _Block >> 1);
+    if (__beg == 0 && __beg != __last) {
+        product_pair(__lhs, __rhs, 0, 0, __half[0], __half[0], __mul);
+        product_pair(__lhs, __rhs, 1, 1, __half[1], __half[1], __mul);
+        ++__beg;
+    }
+
+    /* Pair u (in [h, 2h)) is (h + u, 5h - 1 - u), in the block [2h, 4h). */
+    while (__beg < __last) {
+        const std::size_t h = std::bit_floor(__beg);
+        const std::size_t __stop = std::min(__last, h * 2);
+        for (; __beg != __stop ; ++__beg) {
+            const std::size_t i = h + __beg;
+            const std::size_t j = h * 5 - 1 - __beg;
+            product_pair(__lhs, __rhs, i, j, __half[i], __half[j], __mul);
+        }
+    }
+
+    /* Position p of block j is the frequency r * rev(p) + j. */
+    while (__beg < __end) {
+        const std::size_t __rest = __beg - (_Block >> 1);
+        const std::size_t j = __rest / _Block + 1;
+        const std::size_t __stop = std::min(__end, (_Block >> 1) + j * _Block);
+        const complex __unit = std::polar(1.0, 2 * std::numbers::pi * j / __len);
+        for (std::size_t p = __rest % _Block ; __beg != __stop ; ++__beg, ++p) {
+            const complex __w = cmul(__unit, __half[p]);
+            product_pair(__lhs, __rhs, j * _Block + p, (_Radix - j + 1) * _Block - 1 - p,
+                         __w, std::conj(__w), __mul);
+        }
+    }
+}
+
+/**
+ * @brief Multiply the packed real sequences lhs and rhs with FFT.
+ * @param __lhs Input of length __len, which will be the result.
+ * @param __rhs Input of length __len, which will be modified.
+ * It may be the same as __lhs for squaring.
+ * @param __len Length of FFT, which is r * 2^k (r = 1, 3, 5).
+ * @param __parallel Whether to use the thread pool.
+ */
+inline void FFT_base::FFT_mul_pass(complex *__lhs, complex *__rhs,
+    std::size_t __len, bool __parallel) {
+    using int2048_helper::parallel;
+    const auto __half = make_plan(std::size_t {1} << std::countr_zero(__len)).half;
+    mixed_FFT(__lhs, __len, __parallel);
+    if (__rhs != __lhs) mixed_FFT(__rhs, __len, __parallel);
+    if (!__parallel) {
+        product_FFT(__lhs, __rhs, __half, __len, 0, __len >> 1);
+    } else {
+        parallel::split(__len >> 1, [=](std::size_t __beg, std::size_t __end) {
+            product_FFT(__lhs, __rhs, __half, __len, __beg, __end);
+        });
+    }
+    mixed_IFFT(__lhs, __len, __parallel);
+}
+
+/**
+ * @brief A pass through all things to do in FFT squaring.
+ * @param __fft FFT array generated in fft_sqr.
+ * @param __parallel Whether to use the thread pool.
+ */
+inline void FFT_base::FFT_sqr_pass(FFT_t &__fft, bool __parallel) {
+    return FFT_mul_pass(__fft.begin(), __fft.begin(), __fft.capacity(), __parallel);
+}
+
+} // namespace dark
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "int2048.h"
+
+/* Implementation of fixed-width unsigned integer. */
+namespace dark {
+
+/* Return the lowest _Len words of src, with the leading 0s removed. */
+template <std::size_t _Len>
+uint2048_view uint2048 <_Len>::wrap(uint2048_view src) noexcept {
+    if (src.size() <= _Len) return src;
+    auto __end = src.begin() + _Len;
+    while (__end != src.begin() && __end[-1] == 0) --__end;
+    return uint2048_view {src.begin(), __end};
+}
+
+/**
+ * @brief Construct from an unsigned view.
+ * @note Only the lowest _Len words are kept.
+ */
+template <std::size_t _Len>
+uint2048 <_Len>::uint2048(uint2048_view src) noexcept : data{}, length{0} {
+    length = cpy(data, wrap(src)) - data;
+}
+
+/**
+ * @brief Construct from a signed view, whose sign is ignored.
+ * @note Only the lowest _Len words are kept.
+ */
+template <std::size_t _Len>
+uint2048 <_Len>::uint2048(int2048_view src) noexcept : uint2048(src.to_unsigned()) {}
+
+/**
+ * @brief Construct from a string of decimal digits.
+ * @note Only the lowest max_digits() digits are kept.
+ */
+template <std::size_t _Len>
+uint2048 <_Len>::uint2048(std::string_view __view) noexcept : data{}, length{0} {
+    int2048_stats::on_call(int2048_stats::kernel::parse, (__view.size() + (Base_Length - 1)) / Base_Length);
+    const char *__beg = __view.begin();
+    const char *__end = __view.end();
+
+    /* Filter out all leading 0s. */
+    while (__beg != __end && *__beg == '0') ++__beg;
+    if (__beg == __end) return;
+
+    std::size_t _Length =
+        (__end - __beg + (Base_Length - 1)) / Base_Length;
+    if (_Length > _Len) {
+        _Length = _Len;
+        __beg   = __end - _Len * Base_Length;
+    }
+
+    while (--_Length) {
+        data[length++] = parse_fold <0> (__end);
+        __end -= Base_Length;
+    }
+
+    using int2048_helper::parse_char;
+    _Word_Type __tmp = 0;
+    while (__beg != __end) __tmp = __tmp * 10 + parse_char(*__beg++);
+    data[length++] = __tmp;
+    this->trim(length);
+}
+
+/* Convert explicitly to a big integer. */
+template <std::size_t _Len>
+uint2048 <_Len>::operator int2048() const { return int2048 {int2048_view {*this}}; }
+
+/**
+ * @brief Add rhs to this in place.
+ * @note The carry out of the highest word is dropped.
+ */
+template <std::size_t _Len>
+auto uint2048 <_Len>::operator += (uint2048_view rhs) noexcept -> uint2048 & {
+    const auto __lhs = uint2048_view {*this};
+    const auto __rhs = wrap(rhs);
+    const bool __carry = __lhs.size() < __rhs.size() ?
+        add(data, __rhs, __lhs) : add(data, __lhs, __rhs);
+
+    std::size_t __len = std::max(__lhs.size(), __rhs.size());
+    if (__carry && __len != _Len) data[__len++] = 1;
+    this->trim(__len);
+    return *this;
+}
+
+/**
+ * @brief Subtract rhs from this in place.
+ * @note rhs should be no greater than this, which
+ * is checked only with _DARK_DEBUG.
+ */
+template <std::size_t _Len>
+auto uint2048 <_Len>::operator -= (uint2048_view rhs) -> uint2048 & {
+    const auto __lhs = uint2048_view {*this};
+    const auto __cmp = __lhs <=> rhs;
+#ifdef _DARK_DEBUG
+    if (__cmp < 0) throw error("uint2048: the result of subtraction is negative!");
+#endif
+    length = __cmp == 0 ? 0 : sub(data, __lhs, rhs) - data;
+    return *this;
+}
+
+/**
+ * @brief Multiply this by rhs in place.
+ * The product is done by brute force on the stack.
+ * @note Only the lowest _Len words of the product are kept.
+ */
+template <std::size_t _Len>
+auto uint2048 <_Len>::operator *= (uint2048_view rhs) noexcept -> uint2048 & {
+    const auto __lhs = uint2048_view {*this};
+    const auto __rhs = wrap(rhs);
+    if (__lhs.is_zero() || __rhs.is_zero()) return length = 0, *this;
+
+    _Word_Type __buf[_Len * 2];
+    const std::size_t __len = std::min <std::size_t>
+        (brute_mul(__buf, __lhs, __rhs) - __buf, _Len);
+    std::memcpy(data, __buf, __len * sizeof(_Word_Type));
+    this->trim(__len);
+    return *this;
+}
+
+template <std::size_t _Len>
+std::string uint2048 <_Len>::to_string() const { return uint2048_view {*this}.to_string(); }
+
+template <std::size_t _Len>
+void uint2048 <_Len>::to_string(std::string &__buf) const { uint2048_view {*this}.to_string(__buf); }
+
+/* Return the number of digits of this number. */
+template <std::size_t _Len>
+std::size_t uint2048 <_Len>::digits() const noexcept { return uint2048_view {*this}.digits(); }
+
+} // namespace dark
@@ -68,7 +68,7 @@ int2048 operator + (int2048_view lhs, int2048_view rhs) {
         __ret.sign = lhs.sign;
         if (lhs.size() < rhs.size()) std::swap(lhs,rhs);
         __ret.data.init_capacity(lhs.size() + 1);
-        __ret.data.revacancy(1); /* resize(size() - 1) */
+        __ret.data.resize(lhs.size());
 
         const auto __carry =
             int2048::add(__ret.begin(), lhs.to_unsigned(), rhs.to_unsigned());
@@ -178,14 +178,30 @@ int2048 operator * (int2048_view lhs, int2048_view rhs) {
     return __ret;
 }
 
+/* Return the square of src. */
+int2048 sqr(int2048_view src) {
+    int2048 __ret;
+    if (src.is_zero()) return __ret;
+    __ret.data.init_capacity(src.size() * 2);
+    __ret.data.resize(int2048::sqr(__ret.begin(), src.to_unsigned()));
+    return __ret;
+}
+
 int2048 &operator *= (int2048 &lhs, int2048_view rhs) {
     if (lhs.is_zero() || rhs.is_zero()) return lhs.reset();
+
+    /* lhs and rhs share the storage, which is just a squaring. */
+    if (lhs.begin() == rhs.begin()) {
+        const bool __sign = lhs.sign ^ rhs.sign;
+        return lhs.square().set_sign(__sign);
+    }
+
     lhs.sign ^= rhs.sign;
 
-    /* A simple test of whether brute force is enabled. */
+    /* A simple test of whether brute force (or Karatsuba, Toom-3) is enabled. */
     constexpr auto __use_brute_force = [](std::size_t __l, std::size_t __r) {
-        return (__l < int2048_base::Max_Brute_Mul_Length) |
-               (__r < int2048_base::Max_Brute_Mul_Length);
+        return (__l < int2048_base::Max_Toom3_Mul_Length) |
+               (__r < int2048_base::Max_Toom3_Mul_Length);
     };
 
     /**
@@ -217,6 +233,234 @@ int2048 operator * (int2048_view lhs, int2048 &&rhs) { return std::move(rhs *= l
 int2048 operator * (int2048 &&lhs, int2048_view rhs) { return std::move(lhs *= rhs); }
 int2048 operator * (int2048 &&lhs, int2048 &&rhs) { return std::move(lhs *= std::move(rhs)); }
 
+/**
+ * @brief Divide this by rhs in place, rounded down (towards negative infinity),
+ * and move the remainder (with the same sign as rhs) into __rem.
+ * The old buffer of this is reused for the remainder.
+ * @note rhs should not be 0, and should not view this. __rem should not be this.
+ */
+void int2048::divmod_pass(int2048_view rhs, int2048 &__rem) {
+    const bool __sign = this->sign ^ rhs.sign;
+    const auto __rhs  = rhs.to_unsigned();
+    auto __temp = std::move(this->data);
+    const auto __view = uint2048_view {__temp.begin(), __temp.end()};
+
+    const std::size_t __len = std::max(__view.size(), __rhs.size()) - __rhs.size() + 2;
+    this->data.init_capacity(__len);
+    const auto [__quo, __end] = int2048_base::divmod(this->begin(), __temp.begin(), __view, __rhs);
+    this->data.resize(__quo);
+    __temp.resize(__end);
+
+    /* Different signs: -(q + 1) and |rhs| - r, unless r is 0. */
+    if (__sign && !__temp.empty()) {
+        this->abs_increment();
+        __temp.reserve(__rhs.size());
+        __temp.resize(int2048::sub(__temp.begin(), __rhs, {__temp.begin(), __temp.end()}));
+    }
+    this->sign  = __sign && this->is_non_zero();
+    __rem.data  = std::move(__temp);
+    __rem.sign  = rhs.sign && __rem.is_non_zero();
+}
+
+/**
+ * @brief Set this to lhs / rhs, rounded down (towards negative infinity).
+ * The quotient is written into the buffer of this, and the remainder
+ * goes to scratch. If lhs views this, it is copied to the scratch first,
+ * where the remainder then overwrites it.
+ * @note lhs and rhs should not be 0, and rhs should not view this.
+ */
+void int2048::div_pass(int2048_view lhs, int2048_view rhs) {
+    const bool __sign = lhs.sign ^ rhs.sign;
+    const auto __rhs  = rhs.to_unsigned();
+    auto __lhs = lhs.to_unsigned();
+
+    _Scratch __rem { __lhs.size() };
+    if (__lhs.begin() == this->begin())
+        __lhs = uint2048_view {__rem.begin(), int2048::cpy(__rem.begin(), __lhs)};
+
+    const std::size_t __len = std::max(__lhs.size(), __rhs.size()) - __rhs.size() + 2;
+    this->data.reserve(__len);
+    const auto [__quo, __end] = int2048_base::divmod(this->begin(), __rem.begin(), __lhs, __rhs);
+    this->data.resize(__quo);
+
+    /* Different signs: -(q + 1), unless the remainder is 0. */
+    if (__sign && __end != __rem.begin()) this->abs_increment();
+    this->sign = __sign && this->is_non_zero();
+}
+
+/**
+ * @brief Divide this by rhs, rounded down (towards negative infinity).
+ * The quotient reuses the buffer of this.
+ * @note rhs should not be 0.
+ */
+int2048 &int2048::operator /= (const int2048 &rhs) {
+    if (this->is_zero()) return *this;
+    if (this == &rhs) return *this = _Word_Type {1};
+
+    this->div_pass(*this, rhs);
+    return *this;
+}
+
+/**
+ * @brief Set this to this mod rhs, which has the same sign as rhs.
+ * (i.e. this - rhs * floor(this / rhs))
+ * @note rhs should not be 0.
+ */
+int2048 &int2048::operator %= (const int2048 &rhs) {
+    if (this->is_zero()) return *this;
+    if (this == &rhs) return this->reset();
+
+    const auto __rhs = uint2048_view {rhs};
+    this->data.resize(int2048::mod(this->begin(), uint2048_view {*this}, __rhs));
+    if (this->is_zero()) return this->reset();
+
+    /* Different signs: the result is |rhs| - (|lhs| mod |rhs|). */
+    if (this->sign != rhs.sign) {
+        this->data.reserve(__rhs.size());
+        this->data.resize(int2048::sub(this->begin(), __rhs, uint2048_view {*this}));
+    }
+    this->sign = rhs.sign;
+    return *this;
+}
+
+/* The quotient is written into the result directly, without any copy of lhs. */
+int2048 operator / (int2048_view lhs, const int2048 &rhs) {
+    int2048 __ret {};
+    if (lhs.is_non_zero()) __ret.div_pass(lhs, rhs);
+    return __ret;
+}
+int2048 operator / (int2048 &&lhs, const int2048 &rhs) { return std::move(lhs /= rhs); }
+int2048 operator % (int2048_view lhs, const int2048 &rhs) { return std::move(int2048 {lhs} %= rhs); }
+int2048 operator % (int2048 &&lhs, const int2048 &rhs) { return std::move(lhs %= rhs); }
+
+/**
+ * @brief Divide this by rhs in place, and move the remainder into __rem.
+ * Both are rounded down, just the same as operator / and operator %.
+ * @return Reference to this (the quotient).
+ * @note rhs should not be 0. __rem should not be this.
+ */
+int2048 &int2048::divmod(const int2048 &rhs, int2048 &__rem) & {
+    if (this == &rhs) {
+        __rem.reset();
+        return *this = _Word_Type {1};
+    }
+    if (this->is_zero()) {
+        __rem.reset();
+        return *this;
+    }
+    this->divmod_pass(rhs, __rem);
+    return *this;
+}
+
+/**
+ * @brief Divide this by rhs in place.
+ * @return The remainder, which has the same sign as rhs.
+ * @note rhs should not be 0.
+ */
+int2048 int2048::divmod(const int2048 &rhs) & {
+    int2048 __rem {};
+    this->divmod(rhs, __rem);
+    return __rem;
+}
+
+/**
+ * @brief Work out the quotient and remainder of lhs / rhs in one go.
+ * @return {floor(lhs / rhs), lhs - rhs * floor(lhs / rhs)}.
+ * @note rhs should not be 0.
+ */
+std::pair <int2048, int2048> divmod(int2048_view lhs, int2048_view rhs) {
+    std::pair <int2048, int2048> __ret { int2048 {lhs}, int2048 {} };
+    if (__ret.first.is_non_zero()) __ret.first.divmod_pass(rhs, __ret.second);
+    return __ret;
+}
+
+/**
+ * @brief Divide lhs by rhs, which is known to divide lhs exactly.
+ * This is much faster than operator /, as the quotient is worked
+ * out from the lowest words without estimation or correction.
+ * @note rhs should not be 0. If rhs does not divide lhs, the result
+ * is meaningless, which is checked only with _DARK_DEBUG.
+ */
+int2048 divexact(int2048_view lhs, int2048_view rhs) {
+    int2048 __ret {};
+    const std::size_t __n = lhs.end() - lhs.begin();
+    const std::size_t __m = rhs.end() - rhs.begin();
+    if (__n >= __m && lhs.is_non_zero()) {
+        __ret.data.init_capacity(__n - __m + 1);
+        __ret.data.resize(int2048::exact_div(__ret.begin(), lhs.to_unsigned(), rhs.to_unsigned()));
+        __ret.sign = (lhs.is_negative() ^ rhs.is_negative()) && __ret.is_non_zero();
+    }
+#ifdef _DARK_DEBUG
+    if (__ret * rhs != lhs) throw error("divexact: the divisor does not divide the dividend!");
+#endif
+    return __ret;
+}
+
+/**
+ * @brief Divide this by a builtin integer in place, rounded down.
+ * @return The remainder, which has the same sign as __val.
+ * @note __val should not be 0.
+ */
+template <std::integral _Tp>
+_Tp int2048::divmod(_Tp __val) & {
+    if (this->is_zero()) return 0;
+
+    /* Sign-extend through intmax_t, so that narrower types are negated correctly. */
+    const bool __neg = __val < 0;
+    const _Word_Type __abs = __neg ?
+        _Word_Type {0} - static_cast <_Word_Type> (static_cast <std::intmax_t> (__val)) :
+        static_cast <_Word_Type> (__val);
+
+    _Word_Type __rest = int2048::div_small(this->begin(), uint2048_view {*this}, __abs);
+    while (this->data.size() && this->data[this->size() - 1] == 0) this->data.pop_back();
+
+    /* Different signs: round the quotient down. */
+    const bool __sign = this->sign ^ __neg;
+    if (__sign && __rest != 0) {
+        this->abs_increment();
+        __rest = __abs - __rest;
+    }
+    this->sign = __sign && this->is_non_zero();
+    return static_cast <_Tp> (__neg ? -__rest : __rest);
+}
+
+template <std::integral _Tp>
+int2048 &int2048::operator /= (_Tp __val) { this->divmod(__val); return *this; }
+
+template <std::integral _Tp>
+int2048 operator / (int2048 lhs, _Tp __val) { lhs.divmod(__val); return lhs; }
+
+template <std::integral _Tp>
+int2048 &int2048::operator %= (_Tp __val) {
+    const _Tp __rest = int2048_view {*this} % __val;
+    if constexpr (std::is_signed_v <_Tp>)
+        return *this = static_cast <std::intmax_t> (__rest);
+    else
+        return *this = static_cast <_Word_Type> (__rest);
+}
+
+/**
+ * @brief Work out lhs mod a builtin integer, without any quotient written.
+ * @return The remainder, which has the same sign as __val.
+ * @note __val should not be 0.
+ */
+template <std::integral _Tp>
+_Tp operator % (int2048_view lhs, _Tp __val) {
+    using _Word_Type = int2048::_Word_Type;
+    /* Sign-extend through intmax_t, so that narrower types are negated correctly. */
+    const bool __neg = __val < 0;
+    const _Word_Type __abs = __neg ?
+        _Word_Type {0} - static_cast <_Word_Type> (static_cast <std::intmax_t> (__val)) :
+        static_cast <_Word_Type> (__val);
+
+    auto __rest = int2048::mod_small(lhs.to_unsigned(), __abs);
+    if (lhs.is_negative() != __neg && __rest != 0) __rest = __abs - __rest;
+    return static_cast <_Tp> (__neg ? -__rest : __rest);
+}
+
+template <std::integral _Tp>
+_Tp operator % (const int2048 &lhs, _Tp __val) { return int2048_view {lhs} % __val; }
+
 
 } // namespace dark
 
@@ -301,6 +545,27 @@ int2048 &int2048::abs_decrement() & noexcept {
     } return *this;
 }
 
+/* Return $this * this$ */
+int2048 int2048::square() && { return std::move(this->square()); }
+
+/**
+ * @brief Square this number in place.
+ * @return Reference to this number.
+ */
+int2048 &int2048::square() & {
+    if (this->is_zero()) return *this;
+    this->sign = false;
+
+    /* Same as operator *=, the input must be kept when not enough capacity. */
+    if (data.capacity() < this->size() * 2 || this->size() < Max_Toom3_Mul_Length) {
+        auto __temp = std::move(data);
+        data.init_capacity(__temp.size() * 2);
+        data.resize(int2048::sqr(this->begin(), uint2048_view {__temp.begin(), __temp.end()}));
+    } else { /* Enough capacity, so use the space of this as buffer. */
+        data.resize(int2048::sqr(this->begin(), uint2048_view {*this}));
+    } return *this;
+}
+
 /* Convert this number to std::string. */
 std::string int2048::to_string() const {
     std::string __ret;
@@ -321,6 +586,7 @@ void int2048::read(std::istream &__is) {
 
 /* Parse a number from the given string. */
 void int2048::parse(std::string_view __view) {
+    int2048_stats::on_call(int2048_stats::kernel::parse, (__view.size() + (Base_Length - 1)) / Base_Length);
     const char *__beg = __view.begin();
     const char *__end = __view.end();
 
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "int2048.h"
+
+/* Implementation of montgomery context. */
+namespace dark {
+
+/**
+ * @brief Prepare a context from a given modulus.
+ * @note The modulus should be coprime to Base. Its sign is ignored.
+ */
+montgomery_context::montgomery_context(int2048_view src)
+    : data(src._beg, src._end), minv(), rmod(), rsqr(), ninv(Base - inv_word(data[0])),
+      temp(data.size() * 2 + 1), prod(data.size() * 3 + 1) {
+    const std::size_t __n = data.size();
+
+    /* Long moduli are reduced with multiplications, which need m^(-1) mod R. */
+    if (__n >= Max_Brute_Mul_Length) {
+        minv.init_capacity(__n);
+        inv_mod(minv.begin(), this->modulus_view(), __n);
+        minv.resize(__n);
+        while (minv[minv.size() - 1] == 0) minv.pop_back();
+    }
+
+    /* R mod m and R^2 mod m, where R = Base^n. */
+    const int2048 __mod {this->modulus()};
+    for (auto [__dst, __len] : { std::pair {&rmod, __n}, std::pair {&rsqr, __n * 2} }) {
+        int2048 __pow {};
+        __pow.data.init_capacity(__len + 1);
+        std::memset(__pow.begin(), 0, __len * sizeof(_Word_Type));
+        __pow.data.resize(__len + 1);
+        __pow.data[__len] = 1;
+        __pow %= __mod;
+        *__dst = std::move(__pow.data);
+    }
+}
+
+/* Return the modulus (always positive). */
+int2048_view montgomery_context::modulus() const noexcept {
+    return int2048_view {data.begin(), data.end()};
+}
+
+/* Return the absolute value of modulus. */
+uint2048_view montgomery_context::modulus_view() const noexcept {
+    return uint2048_view {data.begin(), data.end()};
+}
+
+/**
+ * @brief Reduce T in [__beg, __end) to T / R mod m word by word.
+ * Each step adds a multiple of m to clear the lowest word. The words
+ * are not normalized until the end, which is safe as n is less than
+ * Max_Brute_Mul_Length (just the same as brute_mul).
+ * @param __dst Output range, where at most n + 1 words are written.
+ * @return Iterator to the tail of the result, which is in [0, m).
+ * @note T should be less than m * R. At least 2n + 1 words
+ * should be available from __beg, which are all overwritten.
+ */
+auto montgomery_context::brute_redc(_Iterator __dst, _Iterator __beg, _Iterator __end) const noexcept -> _Iterator {
+    const auto __mod = this->modulus_view().begin();
+    const std::size_t __n = data.size();
+    std::memset(__end, 0, (__beg + __n * 2 + 1 - __end) * sizeof(_Word_Type));
+
+    for (std::size_t i = 0 ; i != __n ; ++i) {
+        const _Word_Type __q = __beg[i] % Base * ninv % Base;
+        for (std::size_t j = 0 ; j != __n ; ++j) __beg[i + j] += __q * __mod[j];
+        __beg[i + 1] += __beg[i] / Base;
+    }
+
+    _Word_Type __carry = 0;
+    for (std::size_t i = 0 ; i != __n ; ++i) {
+        const _Word_Type __cur = __beg[__n + i] + __carry;
+        __dst[i] = __cur % Base;
+        __carry  = __cur / Base;
+    } __dst[__n] = __carry;
+
+    auto __tail = __dst + __n + 1;
+    while (__tail != __dst && __tail[-1] == 0) --__tail;
+    const auto __val = uint2048_view {__dst, __tail};
+    const auto __div = this->modulus_view();
+    if (__div <= __val) __tail = __val == __div ? __dst : sub(__dst, __val, __div);
+    return __tail;
+}
+
+/**
+ * @brief Reduce T in [__beg, __end) to T / R mod m.
+ * With q = T * m^(-1) mod R, T - q * m is a multiple of R, and the
+ * lowest n words of T and q * m are just the same. So the result is
+ * T / R - q * m / R (rounded down), which is in (-m, m).
+ * @param __dst Output range, where at most n + 1 words are written.
+ * @return Iterator to the tail of the result, which is in [0, m).
+ * @note T should be less than m * R. At least 2n + 1 words
+ * should be available from __beg.
+ */
+auto montgomery_context::redc(_Iterator __dst, _Iterator __beg, _Iterator __end) const -> _Iterator {
+    const auto __mod = this->modulus_view();
+    const std::size_t __n = __mod.size();
+    if (__n < Max_Brute_Mul_Length) return this->brute_redc(__dst, __beg, __end);
+
+    const auto __trim = [](_Iterator __lo, _Iterator __hi) -> uint2048_view {
+        while (__hi != __lo && __hi[-1] == 0) --__hi;
+        return uint2048_view {__lo, __hi};
+    };
+
+    const auto __mid = std::min(__end, __beg + __n);
+    const auto __low = __trim(__beg, __mid);
+    const auto __top = __trim(__mid, __end);
+    if (__low.is_zero()) return cpy(__dst, __top);
+
+    /* q = T * m^(-1) mod R, and then q * m. */
+    const auto __buf = prod.begin();
+    const auto __quo = __trim(__buf, std::min(mul(__buf, __low, {minv.begin(), minv.end()}), __buf + __n));
+    const auto __end2 = mul(__buf + __n, __quo, __mod);
+    const auto __sub = __trim(__buf + __n * 2, std::max(__end2, __buf + __n * 2));
+
+    if (__sub <= __top) {
+        if (__sub == __top) return __dst;
+        const auto __tail = cpy(__dst, __top);
+        return __sub.is_zero() ? __tail : sub(__dst, {__dst, __tail}, __sub);
+    } else {
+        const auto __tail = __top.is_zero() ? cpy(__dst, __sub) : sub(__dst, __sub, __top);
+        return sub(__dst, __mod, {__dst, __tail});
+    }
+}
+
+/**
+ * @brief Convert a number into Montgomery form, that is, x * R mod m.
+ * @note Any number (even negative) is accepted.
+ */
+int2048 montgomery_context::to_mont(int2048_view src) const {
+    int2048 __ret {src};
+    __ret %= int2048 {this->modulus()};
+    return std::move(this->mulmod(__ret, __ret, int2048_view {rsqr.begin(), rsqr.end()}));
+}
+
+/**
+ * @brief Convert a number in Montgomery form back in place.
+ * @return Reference to the number, which is x / R mod m.
+ * @note The number should be in [0, m).
+ */
+int2048 &montgomery_context::from_mont(int2048 &src) const {
+    if (src.is_zero()) return src;
+    const auto __tail = cpy(temp.begin(), uint2048_view {src});
+    src.data.reserve(data.size() + 1);
+    src.data.resize(this->redc(src.begin(), temp.begin(), __tail));
+    return src;
+}
+
+/**
+ * @brief Work out lhs * rhs / R mod m to __dst, which is the
+ * product of two numbers in Montgomery form.
+ * @return Reference to __dst, which is in [0, m).
+ * @note Both should be in [0, m). __dst may be the same as lhs or rhs.
+ */
+int2048 &montgomery_context::mulmod(int2048 &__dst, int2048_view lhs, int2048_view rhs) const {
+    if (lhs.is_zero() || rhs.is_zero()) return __dst.reset();
+
+    /* The product is done before __dst grows, as they may be the same. */
+    const auto __tail = mul(temp.begin(), lhs.to_unsigned(), rhs.to_unsigned());
+    __dst.data.reserve(data.size() + 1);
+    __dst.data.resize(this->redc(__dst.begin(), temp.begin(), __tail));
+    __dst.sign = false;
+    return __dst;
+}
+
+/* Return lhs * rhs / R mod m. */
+int2048 montgomery_context::mulmod(int2048_view lhs, int2048_view rhs) const {
+    int2048 __ret {};
+    return std::move(this->mulmod(__ret, lhs, rhs));
+}
+
+/**
+ * @brief Return __base^__exp mod m (not in Montgomery form).
+ * @note __exp should be non-negative.
+ */
+int2048 montgomery_context::pow(int2048_view __base, int2048_view __exp) const {
+    int2048 __ret {};
+    if (__exp.is_zero()) {
+        __ret = int2048_view {rmod.begin(), rmod.end()};
+    } else {
+        const int2048 __val = this->to_mont(__base);
+        __ret = pow_window(*this, __val, __exp);
+    } return std::move(this->from_mont(__ret));
+}
+
+/**
+ * @brief Return __base^__exp mod |__mod|. Short moduli coprime to Base
+ * use Montgomery reduction word by word, and the others use Barrett
+ * reduction, which takes one less multiplication for each product.
+ * @note __exp should be non-negative, and __mod should not be 0.
+ */
+int2048 powmod(int2048_view __base, int2048_view __exp, int2048_view __mod) {
+    const int __last = __mod.set_sign(false) % 10;
+    const std::size_t __n = __mod.end() - __mod.begin();
+    if (__n < montgomery_context::Max_Brute_Mul_Length && __last % 2 != 0 && __last != 5)
+        return montgomery_context {__mod}.pow(__base, __exp);
+    else
+        return barrett_reducer {__mod}.pow(__base, __exp);
+}
+
+} // namespace dark
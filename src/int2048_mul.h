@@ -0,0 +1,233 @@
+#pragma once
+
+#include "int2048.h"
+
+/* Implementation of Karatsuba and Toom-Cook multiplication. */
+namespace dark {
+
+/**
+ * @return Upper bound of the scratch space (in words)
+ * used by tier_pass on operands of length __n and __m.
+ */
+std::size_t int2048_base::tier_space(std::size_t __n, std::size_t __m) noexcept {
+    if (__n < __m) std::swap(__n, __m);
+    if (__m < Max_Brute_Mul_Length) return 0;
+    if (__m * 2 <= __n + 1) return __m * 2 + tier_space(__m, __m);
+    const std::size_t __half = (__n >> 1) + 2;
+    return __n * 4 + 32 + tier_space(__half, __half);
+}
+
+/**
+ * @brief Multiply lhs and rhs to __ptr with schoolbook,
+ * Karatsuba or Toom-3, depending on the length.
+ * @param __ptr Output range.
+ * @return Iterator to the tail of the result.
+ * @note This requires that input ranges should not overlap with output range.
+ */
+auto int2048_base::tier_mul(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs)
+-> mul_t {
+    _Scratch __buf { tier_space(lhs.size(), rhs.size()) };
+    tier_pass(__ptr, lhs, rhs, __buf.begin());
+
+    __ptr += lhs.size() + rhs.size();
+    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+    return __ptr;
+}
+
+/**
+ * @brief Choose the suitable way to multiply lhs and rhs.
+ * @param __ptr Output range, where exactly lhs.size() + rhs.size() words are written.
+ * @param __buf Scratch space, at least tier_space(lhs.size(), rhs.size()) words.
+ * @note Leading 0s are allowed in the inputs. If lhs and rhs are
+ * the same range, the square kernels are used all the way down.
+ * Input ranges should not overlap with output range.
+ */
+void int2048_base::tier_pass(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs,
+    _Iterator __buf) noexcept {
+    if (lhs.size() < rhs.size()) std::swap(lhs,rhs);
+    const std::size_t __n = lhs.size();
+    const std::size_t __m = rhs.size();
+
+    if (__m < Max_Brute_Mul_Length) {
+        if (is_same(lhs, rhs)) return (void)brute_sqr(__ptr, lhs);
+        else                   return (void)brute_mul(__ptr, lhs, rhs);
+    }
+
+    /* Karatsuba requires the higher half of rhs to be non-empty. */
+    if (__m * 2 <= __n + 1) { /* Unbalanced: cut lhs into rhs-sized blocks. */
+        std::memset(__ptr, 0, (__n + __m) * sizeof(_Word_Type));
+        const auto __tmp = __buf;
+        __buf += __m * 2;
+        for (std::size_t i = 0 ; i < __n ; i += __m) {
+            const std::size_t __len = std::min(__m, __n - i);
+            tier_pass(__tmp, {lhs.begin() + i, lhs.begin() + i + __len}, rhs, __buf);
+            add_in(__ptr + i, __n + __m - i, {__tmp, __tmp + __len + __m});
+        } return;
+    }
+
+    /* Toom-3 requires the highest third of rhs to be non-empty. */
+    if (__m >= Max_Karatsuba_Mul_Length && __m > (__n + 2) / 3 * 2)
+        return toom3_pass(__ptr, lhs, rhs, __buf);
+    else
+        return karatsuba_pass(__ptr, lhs, rhs, __buf);
+}
+
+/**
+ * @brief Karatsuba multiplication.
+ * (a1 * B^k + a0) * (b1 * B^k + b0) = z2 * B^2k + z1 * B^k + z0,
+ * where z1 = (a1 + a0) * (b1 + b0) - z2 - z0.
+ * @note lhs should be no shorter than rhs, and rhs
+ * should be longer than half of lhs.
+ */
+void int2048_base::karatsuba_pass(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs,
+    _Iterator __buf) noexcept {
+    const std::size_t __n = lhs.size();
+    const std::size_t __m = rhs.size();
+    const std::size_t __k = (__n + 1) >> 1;
+    const std::size_t __l = __k + 1;
+
+    const uint2048_view __a0 {lhs.begin(), lhs.begin() + __k};
+    const uint2048_view __a1 {lhs.begin() + __k, lhs.end()};
+    const uint2048_view __b0 {rhs.begin(), rhs.begin() + __k};
+    const uint2048_view __b1 {rhs.begin() + __k, rhs.end()};
+
+    const auto __sa = __buf;
+    const auto __sb = __buf + __l;
+    const auto __z1 = __buf + __l * 2;
+    __buf += __l * 4;
+
+    /* When squaring, sb is the same as sa and z1 is also a square. */
+    const bool __same = is_same(lhs, rhs);
+    __sa[__k] = add(__sa, __a0, __a1);
+    if (!__same) __sb[__k] = add(__sb, __b0, __b1);
+    const auto __sr = __same ? __sa : __sb;
+    tier_pass(__z1, {__sa, __sa + __l}, {__sr, __sr + __l}, __buf);
+
+    /* z0 and z2 are stored into the output directly. */
+    tier_pass(__ptr, __a0, __b0, __buf);
+    tier_pass(__ptr + __k * 2, __a1, __b1, __buf);
+
+    sub_in(__z1, __l * 2, {__ptr, __ptr + __k * 2});
+    sub_in(__z1, __l * 2, {__ptr + __k * 2, __ptr + __n + __m});
+
+    /* z1 must fit in the rest of the output. */
+    const std::size_t __rest = __n + __m - __k;
+    add_in(__ptr + __k, __rest, {__z1, __z1 + std::min(__l * 2, __rest)});
+}
+
+/**
+ * @brief Toom-3 multiplication, evaluated at 0, 1, -1, 2 and infinity.
+ * Let c0 ~ c4 be the coefficients of the product, then:
+ * (v1 + v-1) / 2 = c0 + c2 + c4, (v1 - v-1) / 2 = c1 + c3,
+ * (v2 - c0 - 4c2 - 16c4) / 2 = c1 + 4c3.
+ * In this order, all the intermediate values are non-negative.
+ * @note lhs should be no shorter than rhs, and rhs
+ * should be longer than two thirds of lhs.
+ */
+void int2048_base::toom3_pass(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs,
+    _Iterator __buf) noexcept {
+    const std::size_t __n = lhs.size();
+    const std::size_t __m = rhs.size();
+    const std::size_t __k = (__n + 2) / 3;
+    const std::size_t __l = __k + 1;
+
+    /* Evaluate a number at 1, -1 and 2, with each value in __l words. */
+    auto __evaluate = [__k, __l](uint2048_view __src, _Iterator __p1,
+                                 _Iterator __m1, _Iterator __p2) -> bool {
+        const uint2048_view __x0 {__src.begin(), __src.begin() + __k};
+        const uint2048_view __x1 {__src.begin() + __k, __src.begin() + __k * 2};
+        const uint2048_view __x2 {__src.begin() + __k * 2, __src.end()};
+
+        /* p1 = x0 + x2, m1 = |x0 + x2 - x1| */
+        __p1[__k] = add(__p1, __x0, __x2);
+        bool __sign = false;
+        std::memcpy(__m1, __p1, __l * sizeof(_Word_Type));
+        if (sub_in(__m1, __l, __x1)) {
+            __sign = true;
+            std::memset(cpy(__m1, __x1), 0, sizeof(_Word_Type));
+            sub_in(__m1, __l, {__p1, __p1 + __l});
+        }
+        add_in(__p1, __l, __x1);
+
+        /* p2 = ((x2 * 2 + x1) * 2) + x0 */
+        std::memset(cpy(__p2, __x2), 0, (__l - __x2.size()) * sizeof(_Word_Type));
+        mul_small(__p2, {__p2, __p2 + __l}, 2);
+        add_in(__p2, __l, __x1);
+        mul_small(__p2, {__p2, __p2 + __l}, 2);
+        add_in(__p2, __l, __x0);
+        return __sign;
+    };
+
+    const auto __eval = __buf;
+    const auto __v1   = __buf + __l * 6;
+    const auto __vm1  = __buf + __l * 8;
+    const auto __v2   = __buf + __l * 10;
+    __buf += __l * 12;
+
+    /* When squaring, rhs is not evaluated and all the products are squares. */
+    const bool __same = is_same(lhs, rhs);
+    const std::size_t __r = __same ? 0 : 3;
+    bool __sign = __evaluate(lhs, __eval, __eval + __l, __eval + __l * 2);
+    if (__same) __sign = false; // v-1 is a square, so it is non-negative.
+    else __sign ^= __evaluate(rhs, __eval + __l * 3, __eval + __l * 4, __eval + __l * 5);
+
+    auto __at = [__eval, __l](std::size_t __i) -> uint2048_view {
+        return {__eval + __l * __i, __eval + __l * (__i + 1)};
+    };
+
+    tier_pass(__v1 , __at(0), __at(__r + 0), __buf);
+    tier_pass(__vm1, __at(1), __at(__r + 1), __buf);
+    tier_pass(__v2 , __at(2), __at(__r + 2), __buf);
+
+    /* c0 and c4 are stored into the output directly. */
+    const uint2048_view __c0 {__ptr, __ptr + __k * 2};
+    const uint2048_view __c4 {__ptr + __k * 4, __ptr + __n + __m};
+    tier_pass(__ptr, {lhs.begin(), lhs.begin() + __k}, {rhs.begin(), rhs.begin() + __k}, __buf);
+    tier_pass(__ptr + __k * 4, {lhs.begin() + __k * 2, lhs.end()},
+                               {rhs.begin() + __k * 2, rhs.end()}, __buf);
+
+    const std::size_t __len = __l * 2;
+    auto __whole = [__len](_Iterator __p) -> uint2048_view { return {__p, __p + __len}; };
+
+    /**
+     * (v1 + |v-1|) / 2 is stored in __vm1, and the rest of v1 in __v1.
+     * If v-1 >= 0, __vm1 = c0 + c2 + c4 and __v1 = c1 + c3.
+     * Otherwise, it is the other way round.
+     */
+    add_in(__vm1, __len, __whole(__v1));
+    div_small(__vm1, __whole(__vm1), 2);
+    sub_in(__v1, __len, __whole(__vm1));
+    const auto __even = __sign ? __v1 : __vm1;
+    const auto __odd  = __sign ? __vm1 : __v1;
+
+    /* c2 = __even - c0 - c4 */
+    sub_in(__even, __len, __c0);
+    sub_in(__even, __len, __c4);
+
+    /* __v2 = (v2 - c0 - 4c2 - 16c4) / 2 = c1 + 4c3 */
+    const auto __tmp = __eval;
+    sub_in(__v2, __len, __c0);
+    mul_small(__tmp, __whole(__even), 4);
+    sub_in(__v2, __len, __whole(__tmp));
+    __tmp[__c4.size()] = mul_small(__tmp, __c4, 16);
+    sub_in(__v2, __len, {__tmp, __tmp + __c4.size() + 1});
+    div_small(__v2, __whole(__v2), 2);
+
+    /* c3 = (__v2 - __odd) / 3, c1 = __odd - c3 */
+    sub_in(__v2, __len, __whole(__odd));
+    div_small(__v2, __whole(__v2), 3);
+    sub_in(__odd, __len, __whole(__v2));
+
+    /* Merge all the coefficients into the output. */
+    std::memset(__ptr + __k * 2, 0, __k * 2 * sizeof(_Word_Type));
+    auto __merge = [__ptr, __len, __k, __end = __n + __m](std::size_t __i, _Iterator __src) {
+        const std::size_t __rest = __end - __k * __i;
+        add_in(__ptr + __k * __i, __rest, {__src, __src + std::min(__len, __rest)});
+    };
+
+    __merge(1, __odd);
+    __merge(2, __even);
+    __merge(3, __v2);
+}
+
+} // namespace dark
@@ -0,0 +1,339 @@
+#pragma once
+
+#include "int2048.h"
+
+/* Implementation of NTT base. */
+namespace dark {
+
+template <std::uint32_t _Mod, std::uint32_t _Root>
+struct NTT_base::modular {
+    /* The prime itself. */
+    inline static constexpr _Mod_Type Mod  = _Mod;
+    /* Primitive root of the prime. */
+    inline static constexpr _Mod_Type Root = _Root;
+
+    static_assert(Mod < (_Mod_Type {1} << 31), "Wrongly implemented!");
+
+    [[__gnu__::__always_inline__]]
+    static constexpr _Mod_Type add(_Mod_Type __x, _Mod_Type __y) noexcept {
+        __x += __y; return __x >= Mod ? __x - Mod : __x;
+    }
+
+    [[__gnu__::__always_inline__]]
+    static constexpr _Mod_Type sub(_Mod_Type __x, _Mod_Type __y) noexcept {
+        return __x >= __y ? __x - __y : __x + Mod - __y;
+    }
+
+    [[__gnu__::__always_inline__]]
+    static constexpr _Mod_Type mul(_Mod_Type __x, _Mod_Type __y) noexcept {
+        return static_cast <std::uint64_t> (__x) * __y % Mod;
+    }
+
+    static constexpr _Mod_Type pow(_Mod_Type __x, std::size_t __y) noexcept {
+        _Mod_Type __ret = 1;
+        do {
+            if (__y & 1) __ret = mul(__ret, __x);
+            __x = mul(__x, __x);
+        } while (__y >>= 1);
+        return __ret;
+    }
+
+    /* Inverse of a number under the prime. */
+    static constexpr _Mod_Type inv(_Mod_Type __x) noexcept { return pow(__x, Mod - 2); }
+};
+
+/**
+ * @brief Make the root table for NTT.
+ * Root of order 2h is stored in [h, 2h) for every h < __len.
+ * @param __ptr Output range, with at least __len space.
+ * @param __len Length of the NTT (a power of 2, at least 2).
+ * @param __inv Whether to make the inverse roots.
+ * @param __parallel Whether to use the thread pool.
+ */
+template <typename _Mod>
+void NTT_base::make_root(_Mod_Type *__ptr, std::size_t __len, bool __inv, bool __parallel) noexcept {
+    using int2048_helper::parallel;
+    std::size_t __half = __len >> 1;
+    _Mod_Type __unit = _Mod::pow(_Mod::Root, (_Mod::Mod - 1) / __len);
+    if (__inv) __unit = _Mod::inv(__unit);
+
+    /* Only the top level is calculated. */
+    auto __top = [=](std::size_t __beg, std::size_t __end) {
+        _Mod_Type __cur = _Mod::pow(__unit, __beg);
+        for (std::size_t i = __beg ; i != __end ; ++i)
+            __ptr[__half + i] = __cur, __cur = _Mod::mul(__cur, __unit);
+    };
+    if (__parallel) parallel::split(__half, __top);
+    else            __top(0, __half);
+
+    /* Lower levels are just the even terms of the upper one. */
+    while (__half >>= 1)
+        for (std::size_t i = 0 ; i != __half ; ++i)
+            __ptr[__half + i] = __ptr[(__half + i) << 1];
+}
+
+/**
+ * @brief Butterflies of forward NTT, at level i.
+ * @param __val Input array, which will be modified.
+ * @param __root Root table generated by make_root.
+ * @param i Half of the block length.
+ * @param __beg Index of the first butterfly to do.
+ * @param __end Index of the last butterfly to do (exclusive).
+ * @note There are __len / 2 butterflies in total, and
+ * butterfly (j * i + k) works on block j at offset k.
+ */
+template <typename _Mod>
+void NTT_base::NTT_level(_Mod_Type *__val, const _Mod_Type *__root, std::size_t i,
+    std::size_t __beg, std::size_t __end) noexcept {
+    const _Mod_Type *__unit = __root + i;
+    while (__beg != __end) {
+        _Mod_Type *__lhs = __val + __beg / i * i * 2;
+        _Mod_Type *__rhs = __lhs + i;
+        std::size_t k = __beg % i;
+        const std::size_t __last = std::min(i, k + (__end - __beg));
+        __beg += __last - k;
+        for (; k != __last ; ++k) {
+            const auto __x = __lhs[k];
+            const auto __y = __rhs[k];
+            __lhs[k] = _Mod::add(__x, __y);
+            __rhs[k] = _Mod::mul(_Mod::sub(__x, __y), __unit[k]);
+        }
+    }
+}
+
+/**
+ * @brief Butterflies of inverse NTT, at level i.
+ * @note Parameters are the same as NTT_level,
+ * except that __root should be the inverse one.
+ */
+template <typename _Mod>
+void NTT_base::INTT_level(_Mod_Type *__val, const _Mod_Type *__root, std::size_t i,
+    std::size_t __beg, std::size_t __end) noexcept {
+    const _Mod_Type *__unit = __root + i;
+    while (__beg != __end) {
+        _Mod_Type *__lhs = __val + __beg / i * i * 2;
+        _Mod_Type *__rhs = __lhs + i;
+        std::size_t k = __beg % i;
+        const std::size_t __last = std::min(i, k + (__end - __beg));
+        __beg += __last - k;
+        for (; k != __last ; ++k) {
+            const auto __x = __lhs[k];
+            const auto __y = _Mod::mul(__rhs[k], __unit[k]);
+            __lhs[k] = _Mod::add(__x, __y);
+            __rhs[k] = _Mod::sub(__x, __y);
+        }
+    }
+}
+
+/**
+ * @brief Forward NTT (decimation in frequency).
+ * @param __val Input array, which will be modified.
+ * @param __root Root table generated by make_root.
+ * @param __len Length of the array.
+ * @note The output is in bit-reversed order, which
+ * is exactly what INTT requires as input.
+ */
+template <typename _Mod>
+void NTT_base::NTT(_Mod_Type *__val, const _Mod_Type *__root, std::size_t __len) noexcept {
+    for (std::size_t i = __len >> 1 ; i != 0 ; i >>= 1)
+        NTT_level <_Mod> (__val, __root, i, 0, __len >> 1);
+}
+
+/**
+ * @brief Inverse NTT (decimation in time), without the 1/n factor.
+ * @param __val Input array in bit-reversed order, which will be modified.
+ * @param __root Inverse root table generated by make_root.
+ * @param __len Length of the array.
+ */
+template <typename _Mod>
+void NTT_base::INTT(_Mod_Type *__val, const _Mod_Type *__root, std::size_t __len) noexcept {
+    for (std::size_t i = 1 ; i != __len ; i <<= 1)
+        INTT_level <_Mod> (__val, __root, i, 0, __len >> 1);
+}
+
+/**
+ * @brief Forward NTT with the thread pool.
+ * Top levels are split by butterflies, until there are
+ * enough independent blocks for all the threads.
+ * @note The result is the same as NTT.
+ */
+template <typename _Mod>
+void NTT_base::parallel_NTT(_Mod_Type *__val, const _Mod_Type *__root, std::size_t __len) noexcept {
+    using int2048_helper::parallel;
+    std::size_t i = __len;
+    for (; i >= 2 && __len / i < parallel::width() ; i >>= 1)
+        parallel::split(__len >> 1, [=](std::size_t __beg, std::size_t __end) {
+            NTT_level <_Mod> (__val, __root, i >> 1, __beg, __end);
+        });
+
+    parallel::split(__len / i, [=](std::size_t __beg, std::size_t __end) {
+        for (std::size_t j = __beg ; j != __end ; ++j) NTT <_Mod> (__val + j * i, __root, i);
+    });
+}
+
+/**
+ * @brief Inverse NTT with the thread pool.
+ * @note The result is the same as INTT.
+ */
+template <typename _Mod>
+void NTT_base::parallel_INTT(_Mod_Type *__val, const _Mod_Type *__root, std::size_t __len) noexcept {
+    using int2048_helper::parallel;
+    std::size_t i = __len;
+    while (i >= 2 && __len / i < parallel::width()) i >>= 1;
+
+    parallel::split(__len / i, [=](std::size_t __beg, std::size_t __end) {
+        for (std::size_t j = __beg ; j != __end ; ++j) INTT <_Mod> (__val + j * i, __root, i);
+    });
+
+    for (; i != __len ; i <<= 1)
+        parallel::split(__len >> 1, [=](std::size_t __beg, std::size_t __end) {
+            INTT_level <_Mod> (__val, __root, i, __beg, __end);
+        });
+}
+
+} // namespace dark
+
+
+/* Implementation of NTT multiplication. */
+namespace dark {
+
+/**
+ * @brief Work out lhs * rhs under one of the NTT primes.
+ * @param __dst Output array. Its capacity is the NTT length.
+ * @param __buf Buffer array with the same capacity.
+ * @param __parallel Whether to use the thread pool.
+ * @note Inputs will not be touched after they are loaded,
+ * so the output range of mul may overlap with them.
+ */
+template <typename _Mod>
+void int2048_base::NTT_pass(NTT_t &__dst, NTT_t &__buf, uint2048_view lhs, uint2048_view rhs,
+    bool __parallel) {
+    using int2048_helper::parallel;
+    const std::size_t _Length = __dst.capacity();
+
+    NTT_t __root { _Length << 1 };
+    make_root <_Mod> (__root.begin(), _Length, false, __parallel);
+    make_root <_Mod> (__root.begin() + _Length, _Length, true, __parallel);
+
+    /* Each word is less than any of the primes. */
+    auto __load = [_Length](_Mod_Type *__ptr, uint2048_view __src) {
+        for (const auto __val : __src) *__ptr++ = __val;
+        std::memset(__ptr, 0, (_Length - __src.size()) * sizeof(_Mod_Type));
+    };
+
+    auto __forward = [&](_Mod_Type *__ptr) {
+        if (__parallel) parallel_NTT <_Mod> (__ptr, __root.begin(), _Length);
+        else            NTT <_Mod> (__ptr, __root.begin(), _Length);
+    };
+
+    __load(__dst.begin(), lhs);
+    __forward(__dst.begin());
+
+    /* Squaring needs only one forward transform. */
+    const _Mod_Type *__rhs = __dst.begin();
+    if (!is_same(lhs, rhs)) {
+        __load(__buf.begin(), rhs);
+        __forward(__buf.begin());
+        __rhs = __buf.begin();
+    }
+
+    const _Mod_Type __inv = _Mod::inv(_Length % _Mod::Mod);
+    auto __merge = [__dst = __dst.begin(), __rhs, __inv](std::size_t __beg, std::size_t __end) {
+        for (std::size_t i = __beg ; i != __end ; ++i)
+            __dst[i] = _Mod::mul(_Mod::mul(__dst[i], __rhs[i]), __inv);
+    };
+
+    if (__parallel) {
+        parallel::split(_Length, __merge);
+        parallel_INTT <_Mod> (__dst.begin(), __root.begin() + _Length, _Length);
+    } else {
+        __merge(0, _Length);
+        INTT <_Mod> (__dst.begin(), __root.begin() + _Length, _Length);
+    }
+}
+
+/**
+ * @brief Multiply lhs and rhs to __ptr with 3-prime NTT.
+ * The result is exact, and there is no limit on length.
+ * @param __ptr Output range.
+ * @return Iterator to the tail of the result.
+ * @note lhs.size() + rhs.size() words are always written.
+ */
+auto int2048_base::ntt_mul(_Iterator __ptr, uint2048_view lhs, uint2048_view rhs)
+-> mul_t {
+    static_assert(Base < NTT_Mod0::Mod, "Wrongly implemented!");
+    if (lhs.size() < rhs.size()) std::swap(lhs,rhs);
+    const std::size_t _Max_Length = lhs.size() + rhs.size();
+
+    /* Too long for one NTT: split lhs into 2 halves. */
+    if (_Max_Length - 1 > (std::size_t {1} << NTT_Max)) {
+        const std::size_t __half = lhs.size() >> 1;
+        uint2048_view __lo {lhs.begin(), lhs.begin() + __half};
+        uint2048_view __hi {lhs.begin() + __half, lhs.end()};
+
+        /* High part first, since __ptr may overlap with the inputs. */
+        const std::size_t _Hi_Length = __hi.size() + rhs.size();
+        _Scratch __tmp { _Hi_Length };
+        ntt_mul(__tmp.begin(), __hi, rhs);
+        ntt_mul(__ptr, __lo, rhs);
+
+        const auto __mid = __ptr + __half;
+        const auto __end = __ptr + __half + rhs.size();
+        std::memset(__end, 0, (_Max_Length - __half - rhs.size()) * sizeof(_Word_Type));
+        add(__mid, {__tmp.begin(), __tmp.begin() + _Hi_Length}, {__mid, __end});
+
+        __ptr += _Max_Length;
+        if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+        return __ptr;
+    }
+
+    int2048_stats::on_call(int2048_stats::kernel::ntt_mul, lhs.size());
+    const std::size_t _Length = std::bit_ceil(_Max_Length - 1);
+
+    NTT_t __res0, __res1, __res2, __buf;
+    __res0.init_capacity(_Length);
+    __res1.init_capacity(_Length);
+    __res2.init_capacity(_Length);
+    __buf.init_capacity(_Length);
+
+    const bool __parallel = int2048_helper::parallel::enabled(_Max_Length);
+    NTT_pass <NTT_Mod0> (__res0, __buf, lhs, rhs, __parallel);
+    NTT_pass <NTT_Mod1> (__res1, __buf, lhs, rhs, __parallel);
+    NTT_pass <NTT_Mod2> (__res2, __buf, lhs, rhs, __parallel);
+
+    /* Constants for CRT (Garner's algorithm). */
+    constexpr _Word_Type _Mod0  = NTT_Mod0::Mod;
+    constexpr _Word_Type _Mod01 = _Mod0 * NTT_Mod1::Mod;
+    constexpr _Mod_Type  _Inv0  = NTT_Mod1::inv(NTT_Mod0::Mod);
+    constexpr _Mod_Type  _Inv1  = NTT_Mod2::inv(NTT_Mod0::Mod);
+    constexpr _Mod_Type  _Inv2  = NTT_Mod2::inv(NTT_Mod1::Mod % NTT_Mod2::Mod);
+
+    /**
+     * Result = __x0 + __x1 * _Mod0 + __x2 * _Mod01.
+     * Since _Mod01 * __x2 may overflow, we split _Mod01 by Base.
+     * The true value of each term is less than min(n,m) * Base^2,
+     * so the carry will never overflow.
+     */
+    constexpr _Word_Type _Mod01_Lo = _Mod01 % Base;
+    constexpr _Word_Type _Mod01_Hi = _Mod01 / Base;
+
+    const auto __r0 = __res0.begin();
+    const auto __r1 = __res1.begin();
+    const auto __r2 = __res2.begin();
+    __ptr[_Max_Length - 1] = carry_pass(__ptr, _Max_Length - 1, __parallel,
+        [__r0, __r1, __r2](std::size_t i) {
+            const _Mod_Type __x0 = __r0[i];
+            const _Mod_Type __x1 = NTT_Mod1::mul(NTT_Mod1::sub(__r1[i], __x0), _Inv0);
+            const _Mod_Type __x2 = NTT_Mod2::mul(
+                NTT_Mod2::sub(NTT_Mod2::mul(NTT_Mod2::sub(__r2[i], __x0), _Inv1), __x1), _Inv2);
+            return std::pair <_Word_Type, _Word_Type> {
+                __x0 + __x1 * _Mod0 + __x2 * _Mod01_Lo, __x2 * _Mod01_Hi
+            };
+        });
+
+    __ptr += _Max_Length;
+    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+    return __ptr;
+}
+
+} // namespace dark
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "int2048.h"
+
+/* Implementation of prepared multiplier. */
+namespace dark {
+
+/**
+ * @brief Prepare a multiplier from a given value.
+ * @note Spectra are built on first use of each length.
+ */
+prepared_multiplier::prepared_multiplier(int2048_view src)
+    : data(src._beg, src._end), sign(src.sign), cache(new _Cache_Type) {}
+
+/* Return the value of the multiplier. */
+int2048_view prepared_multiplier::value() const noexcept {
+    return int2048_view {data.begin(), data.end(), sign};
+}
+
+/**
+ * @brief Return the spectra of the value for FFT length _Length.
+ * The value is cut into chunks of _Length / 2 words (or kept
+ * whole if it fits), and each chunk takes _Length complex numbers.
+ * @note This is built only once, even if called by many threads.
+ */
+auto prepared_multiplier::spectrum(std::size_t _Length) const -> const complex * {
+    const std::size_t __lg = std::countr_zero(_Length);
+    std::call_once(cache->flag[__lg], [this, _Length, __lg]() {
+        const std::size_t __m     = data.size();
+        const std::size_t __chunk = std::min(__m, _Length >> 1);
+        const std::size_t __count = (__m + __chunk - 1) / __chunk;
+        const auto __root = make_plan(_Length).root;
+
+        auto &__fft = cache->data[__lg];
+        __fft.init_capacity(__count * _Length);
+        for (std::size_t i = 0 ; i != __count ; ++i) {
+            const auto __beg = data.begin() + i * __chunk;
+            const auto __end = data.begin() + std::min(__m, i * __chunk + __chunk);
+            load_FFT(__fft.begin() + i * _Length, {__beg, __end}, _Length, FFT_BaseLen);
+            FFT(__fft.begin() + i * _Length, __root, _Length);
+        }
+    });
+    return cache->data[__lg].begin();
+}
+
+/**
+ * @brief Multiply the value and rhs to __ptr with cached spectra.
+ * If rhs is the longer one, it is cut into blocks, each
+ * transformed once and multiplied by the whole value.
+ * Otherwise, rhs is transformed once and multiplied by
+ * each chunk of the value.
+ * @param __ptr Output range, which should not overlap with rhs.
+ * @return Iterator to the tail of the result.
+ * @note Both of the lengths should be in
+ * [Max_Toom3_Mul_Length, fft_mul_limit / 2].
+ */
+auto prepared_multiplier::mul_pass(_Iterator __ptr, uint2048_view rhs) const -> mul_t {
+    const std::size_t __n = rhs.size();
+    const std::size_t __m = data.size();
+    int2048_stats::on_call(int2048_stats::kernel::fft_mul, std::max(__n, __m));
+    const std::size_t _Length = std::bit_ceil(std::min(__n, __m) * 2);
+    const std::size_t __chunk = std::min(__m, _Length >> 1);
+    const std::size_t __count = (__m + __chunk - 1) / __chunk;
+    const std::size_t _Block  = _Length - __chunk;
+    const auto [__root, __half] = make_plan(_Length);
+    const complex *__spec = this->spectrum(_Length);
+
+    FFT_t __fft, __cur;
+    __fft.init_capacity(_Length);
+    if (__count != 1) __cur.init_capacity(_Length);
+
+    _Scratch __tmp { _Length };
+    std::memset(__ptr, 0, (__n + __m) * sizeof(_Word_Type));
+    for (std::size_t i = 0 ; i < __n ; i += _Block) {
+        const std::size_t __len = std::min(_Block, __n - i);
+        load_FFT(__fft.begin(), {rhs.begin() + i, rhs.begin() + i + __len}, _Length, FFT_BaseLen);
+        FFT(__fft.begin(), __root, _Length);
+
+        for (std::size_t j = 0 ; j != __count ; ++j) {
+            const std::size_t __off  = j * __chunk;
+            const std::size_t __size = std::min(__chunk, __m - __off) + __len;
+
+            /* Keep the spectrum of rhs if it is used again. */
+            auto *__cpx = __fft.begin();
+            if (__count != 1) {
+                __cpx = __cur.begin();
+                std::memcpy((void *)__cpx, __fft.begin(), _Length * sizeof(complex));
+            }
+
+            product_FFT(__cpx, __spec + j * _Length, __half, _Length, 0, _Length >> 1);
+            IFFT(__cpx, __root, _Length);
+            if (FFT_guard(__cpx, _Length, false)) {
+                unload_FFT(__tmp.begin(), __cpx, __size, _Length, FFT_BaseLen, false);
+            } else {
+                const auto __val = data.begin() + __off;
+                ntt_mul(__tmp.begin(), {rhs.begin() + i, rhs.begin() + i + __len},
+                    {__val, __val + (__size - __len)});
+            }
+            add_in(__ptr + i + __off, __n + __m - i - __off, {__tmp.begin(), __tmp.begin() + __size});
+        }
+    }
+
+    __ptr += __n + __m;
+    if (__ptr[-1] == 0) --__ptr; // Remove the leading 0.
+    return __ptr;
+}
+
+/**
+ * @brief Multiply the value by rhs.
+ * @note Short or too long operands just
+ * fall back to the normal multiplication.
+ */
+int2048 prepared_multiplier::mul(int2048_view rhs) const {
+    int2048 __ret {};
+    if (data.empty() || rhs.is_zero()) return __ret;
+    __ret.sign = sign ^ rhs.sign;
+    __ret.data.init_capacity(data.size() + rhs.size());
+
+    const std::size_t __min = std::min(data.size(), rhs.size());
+    if (__min < Max_Toom3_Mul_Length || __min * 2 > fft_mul_limit) {
+        const uint2048_view __val {data.begin(), data.end()};
+        __ret.data.resize(int2048_base::mul(__ret.begin(), __val, rhs.to_unsigned()));
+    } else {
+        __ret.data.resize(this->mul_pass(__ret.begin(), rhs.to_unsigned()));
+    } return __ret;
+}
+
+int2048 operator * (const prepared_multiplier &lhs, int2048_view rhs) { return lhs.mul(rhs); }
+int2048 operator * (int2048_view lhs, const prepared_multiplier &rhs) { return rhs.mul(lhs); }
+
+} // namespace dark
@@ -8,8 +8,10 @@ namespace dark {
 uint2048_view::uint2048_view(const int2048 &src)
 noexcept : _beg(src.data.begin()), _end(src.data.end()) {}
 
-/* Not completed... */
-uint2048_view::uint2048_view(const uint2048 &) noexcept { std::terminate(); }
+/* Construct implicitly from a fixed-width integer. */
+template <std::size_t _Len>
+uint2048_view::uint2048_view(const uint2048 <_Len> &src)
+noexcept : _beg(src.data), _end(src.data + src.length) {}
 
 /* Construct explicitly from a signed view. */
 uint2048_view::uint2048_view(int2048_view src)
@@ -28,6 +30,7 @@ void uint2048_view::to_string(std::string &__buf) const {
     if (this->is_zero()) { __buf += '0'; return; }
     const std::size_t _Max_Length =
         __buf.size() + this->size() * Base_Length;
+    __buf.reserve(_Max_Length);
 
     char *__end = __buf.end().base();
     __buf.resize(_Max_Length);
@@ -70,8 +73,10 @@ namespace dark {
 int2048_view::int2048_view(const int2048 &src)
 noexcept : _beg(src.data.begin()), _end(src.data.end()), sign(src.sign) {}
 
-/* Not completed... */
-int2048_view::int2048_view(const uint2048 &) noexcept { std::terminate(); }
+/* Construct explicitly from a fixed-width integer. */
+template <std::size_t _Len>
+int2048_view::int2048_view(const uint2048 <_Len> &src)
+noexcept : _beg(src.data), _end(src.data + src.length), sign(false) {}
 
 /* Construct explicitly from an unsigned view.  */
 int2048_view::int2048_view(uint2048_view src)
@@ -9,7 +9,9 @@
 #include <utility>
 #include <type_traits>
 #include <cstdlib>
+#include <bit>
 #include <bits/allocator.h> // Used for constexpr allocator.
+#include "stats.h"
 
 namespace dark {
 
@@ -332,6 +334,146 @@ using ::std::free;
 #endif
 
 
+#ifdef _DARK_POOL
+
+/**
+ * @brief Thread-local pool of memory blocks in power-of-two size classes,
+ * which matches the capacities of a vector growing by doubling. Freed
+ * blocks are kept in the free list of the calling thread and reused,
+ * so short-lived temporaries need no malloc/free in the steady state.
+ * Blocks larger than Max_Block_Size go to malloc/free directly.
+ * Only the blocks really taken from or given back to the heap are
+ * counted by int2048_stats, not those served by the free lists.
+ * @note Enabled only with _DARK_POOL.
+ */
+struct memory_pool {
+    /* Smallest size class, in bytes. */
+    inline static constexpr size_t Min_Block_Size = 64;
+    /* Largest size class, in bytes. Larger blocks are not pooled. */
+    inline static constexpr size_t Max_Block_Size = size_t {1} << 20;
+    /* Maximum bytes kept in one size class of one thread. */
+    inline static constexpr size_t Max_Class_Cache = size_t {1} << 23;
+
+    /* Usage of the pool of one thread. */
+    struct usage_t {
+        size_t cached_bytes;    /* Bytes kept in the free lists.         */
+        size_t cached_blocks;   /* Blocks kept in the free lists.        */
+        size_t hits;            /* Allocations served by the free lists. */
+        size_t misses;          /* Pooled allocations that call malloc.  */
+        size_t large;           /* Allocations too large to be pooled.   */
+    };
+
+  protected:
+    inline static constexpr size_t Min_Shift = std::countr_zero(Min_Block_Size);
+    inline static constexpr size_t Classes   = std::countr_zero(Max_Block_Size) - Min_Shift + 1;
+
+    struct node { node *next; };
+
+    struct cache_t {
+        node   *list[Classes];  /* Free list of each size class.             */
+        size_t  bytes[Classes]; /* Bytes kept in each free list.             */
+        size_t  hits;
+        size_t  misses;
+        size_t  large;
+        bool    owned;          /* Whether the guard of the thread is set.   */
+        bool    closed;         /* Whether the thread is exiting.            */
+    };
+
+    /* Give back all the blocks at thread exit. Blocks freed later are not kept. */
+    struct guard_t {
+        ~guard_t() noexcept { memory_pool::trim(cache); cache.closed = true; }
+    };
+
+    inline static thread_local constinit cache_t cache {};
+
+    /* Size class of a block of __n bytes (__n <= Max_Block_Size). */
+    static size_t class_of(size_t __n) noexcept {
+        return __n <= Min_Block_Size ? 0 : std::bit_width(__n - 1) - Min_Shift;
+    }
+
+    static void trim(cache_t &__cache) noexcept {
+        for (size_t __k = 0 ; __k != Classes ; ++__k) {
+            for (node *__ptr = __cache.list[__k] ; __ptr != nullptr ; ) {
+                node *const __next = __ptr->next;
+                int2048_stats::on_free(Min_Block_Size << __k);
+                ::dark::free(__ptr);
+                __ptr = __next;
+            }
+            __cache.list[__k]  = nullptr;
+            __cache.bytes[__k] = 0;
+        }
+    }
+
+  public:
+    /* Allocate a block of at least __n bytes. */
+    static void *allocate(size_t __n) {
+        cache_t &__cache = cache;
+        if (__n > Max_Block_Size) {
+            ++__cache.large;
+            int2048_stats::on_alloc(__n);
+            return ::dark::malloc(__n);
+        }
+
+        const size_t __k = class_of(__n);
+        if (node *const __ptr = __cache.list[__k]) {
+            ++__cache.hits;
+            __cache.list[__k] = __ptr->next;
+            __cache.bytes[__k] -= Min_Block_Size << __k;
+            return __ptr;
+        } else {
+            ++__cache.misses;
+            int2048_stats::on_alloc(Min_Block_Size << __k);
+            return ::dark::malloc(Min_Block_Size << __k);
+        }
+    }
+
+    /**
+     * @brief Give back a block of __n bytes.
+     * @note __n should be the same as the one in allocation. The block
+     * may come from another thread, as blocks of one class are alike.
+     */
+    static void deallocate(void *__ptr, size_t __n) noexcept {
+        if (__ptr == nullptr) return;
+        if (__n > Max_Block_Size) {
+            int2048_stats::on_free(__n);
+            return ::dark::free(__ptr);
+        }
+
+        cache_t &__cache = cache;
+        const size_t __k = class_of(__n);
+        if (__cache.closed || __cache.bytes[__k] >= Max_Class_Cache) {
+            int2048_stats::on_free(Min_Block_Size << __k);
+            return ::dark::free(__ptr);
+        }
+        if (!__cache.owned) {
+            [[maybe_unused]] static thread_local guard_t __guard;
+            __cache.owned = true;
+        }
+
+        node *const __node = static_cast <node *> (__ptr);
+        __node->next = __cache.list[__k];
+        __cache.list[__k] = __node;
+        __cache.bytes[__k] += Min_Block_Size << __k;
+    }
+
+    /* Give back all the blocks kept by the calling thread to the system. */
+    static void trim() noexcept { return trim(cache); }
+
+    /* Return the usage of the pool of the calling thread. */
+    static usage_t usage() noexcept {
+        const cache_t &__cache = cache;
+        usage_t __ret { 0, 0, __cache.hits, __cache.misses, __cache.large };
+        for (size_t __k = 0 ; __k != Classes ; ++__k) {
+            __ret.cached_bytes  += __cache.bytes[__k];
+            __ret.cached_blocks += __cache.bytes[__k] >> (__k + Min_Shift);
+        }
+        return __ret;
+    }
+};
+
+#endif
+
+
 /* A simple allocator. */
 template <class _Tp>
 struct allocator {
@@ -353,7 +495,12 @@ struct allocator {
         if (std::is_constant_evaluated()) {
             return std::allocator <_Tp> {}.allocate(__n);
         } else {
+#ifdef _DARK_POOL
+            return static_cast <_Tp *> (memory_pool::allocate(__n * __N));
+#else
+            int2048_stats::on_alloc(__n * __N);
             return static_cast <_Tp *> (::dark::malloc(__n * __N));
+#endif
         }
     }
 
@@ -363,7 +510,12 @@ struct allocator {
         if (std::is_constant_evaluated()) {
             return std::allocator <_Tp> {}.deallocate(__ptr,__n);
         } else {
+#ifdef _DARK_POOL
+            return memory_pool::deallocate(__ptr, __n * __N);
+#else
+            if (__ptr != nullptr) int2048_stats::on_free(__n * __N);
             return ::dark::free(__ptr);
+#endif
         }
     }
 };
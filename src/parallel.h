@@ -0,0 +1,156 @@
+#pragma once
+
+#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+namespace dark::int2048_helper {
+
+/**
+ * @brief A simple fork-join thread pool for int2048 to use.
+ * The calling thread also takes part in the work.
+ */
+struct thread_pool {
+  protected:
+    using _Task_Type = void (*)(void *, std::size_t);
+
+    std::vector <std::thread> workers;
+
+    std::mutex              call_mtx;   // Held by the caller using the workers.
+    std::mutex              mtx;
+    std::condition_variable cv_work;
+    std::condition_variable cv_done;
+
+    _Task_Type  task;       // Current task.
+    void *      data;       // Data of the task.
+    std::size_t count;      // Number of jobs.
+    std::size_t active;     // Number of workers still working.
+    std::size_t generation; // Increased for every new task.
+    bool        stop;
+
+    std::atomic <std::size_t> next; // Next job to take.
+
+    /* Whether this thread is running some jobs of a pool. */
+    inline static thread_local bool inside = false;
+
+    /* Take jobs until there is none left. */
+    void work() noexcept {
+        std::size_t i;
+        while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count) task(data, i);
+    }
+
+    void loop() noexcept {
+        inside = true;
+        std::size_t __seen = 0;
+        while (true) {
+            {
+                std::unique_lock __lock {mtx};
+                cv_work.wait(__lock, [&] { return stop || generation != __seen; });
+                if (stop) return;
+                __seen = generation;
+            }
+            this->work();
+            {
+                std::lock_guard __lock {mtx};
+                if (--active == 0) cv_done.notify_one();
+            }
+        }
+    }
+
+  public:
+    /* Create a pool of __n threads (including the caller). */
+    explicit thread_pool(std::size_t __n)
+        : task(), data(), count(), active(), generation(), stop(false), next() {
+        for (std::size_t i = 1 ; i < __n ; ++i)
+            workers.emplace_back([this] { this->loop(); });
+    }
+
+    ~thread_pool() noexcept {
+        {
+            std::lock_guard __lock {mtx};
+            stop = true;
+        }
+        cv_work.notify_all();
+        for (auto &__worker : workers) __worker.join();
+    }
+
+    /* Number of threads, including the caller. */
+    std::size_t size() const noexcept { return workers.size() + 1; }
+
+    /**
+     * @brief Run __func(i) for every i in [0, __n), and wait for all.
+     * @note Nested calls from inside a job are run sequentially. So are
+     * calls made while another thread is using the workers, instead of
+     * waiting for them, so that independent threads still run alongside.
+     * __func should not throw.
+     */
+    template <typename _Func>
+    void run(std::size_t __n, _Func &&__func) {
+        auto __serial = [&] { for (std::size_t i = 0 ; i != __n ; ++i) __func(i); };
+        if (inside || __n <= 1 || workers.empty()) return __serial();
+
+        std::unique_lock __call {call_mtx, std::try_to_lock};
+        if (!__call.owns_lock()) return __serial();
+        {
+            std::lock_guard __lock {mtx};
+            task = [](void *__ptr, std::size_t i) {
+                (*static_cast <std::remove_reference_t <_Func> *> (__ptr))(i);
+            };
+            data    = std::addressof(__func);
+            count   = __n;
+            active  = workers.size();
+            next.store(0, std::memory_order_relaxed);
+            ++generation;
+        }
+        cv_work.notify_all();
+
+        inside = true;
+        this->work();
+        inside = false;
+
+        std::unique_lock __lock {mtx};
+        cv_done.wait(__lock, [this] { return active == 0; });
+    }
+};
+
+/* Global settings of parallel execution. */
+struct parallel {
+    /* The thread pool. Null if parallel execution is disabled. */
+    inline static std::unique_ptr <thread_pool> pool {};
+    /* Minimum length (in words) of a multiplication to run in parallel. */
+    inline static std::size_t threshold = 0;
+
+    /* Whether a problem of length __len should run in parallel. */
+    static bool enabled(std::size_t __len) noexcept { return pool && __len >= threshold; }
+
+    /* Number of threads to use. */
+    static std::size_t width() noexcept { return pool ? pool->size() : 1; }
+
+    /* Run __func(i) for every i in [0, __n) with the pool. */
+    template <typename _Func>
+    static void run(std::size_t __n, _Func &&__func) {
+        if (pool) return pool->run(__n, __func);
+        for (std::size_t i = 0 ; i != __n ; ++i) __func(i);
+    }
+
+    /**
+     * @brief Split [0, __len) into width() chunks, and run
+     * __func(__beg, __end) on each chunk with the pool.
+     */
+    template <typename _Func>
+    static void split(std::size_t __len, _Func &&__func) {
+        const std::size_t __n = width();
+        const std::size_t __step = (__len + __n - 1) / __n;
+        return run(__n, [&](std::size_t i) {
+            const std::size_t __beg = std::min(__len, __step * i);
+            const std::size_t __end = std::min(__len, __step * i + __step);
+            if (__beg != __end) __func(__beg, __end);
+        });
+    }
+};
+
+} // namespace dark::int2048_helper
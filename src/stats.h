@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+namespace dark {
+
+/**
+ * @brief Counters of heap allocations, kernel calls and the FFT precision
+ * guard, which are cheap enough to be always on. Each thread counts in its
+ * own block without any atomic read-modify-write, and snapshot() sums up
+ * all the blocks (including those of the threads which have exited).
+ * For the peak, each thread moves its live bytes to a shared counter
+ * every Flush_Bytes, so the peak may miss at most Flush_Bytes per thread.
+ * @note Define _DARK_NO_STATS to remove all the counting at compile time,
+ * and then snapshot() always returns zeros.
+ */
+struct int2048_stats {
+    /* Kernels that are counted. */
+    enum class kernel : std::size_t {
+        brute_mul,  /* Schoolbook multiplication and squaring.          */
+        fft_mul,    /* FFT multiplication and squaring.                 */
+        ntt_mul,    /* Each product of exact 3-prime NTT.               */
+        brute_div,  /* Schoolbook division (Knuth's algorithm D).       */
+        div,        /* Any division, mod or divmod of two numbers.      */
+        parse,      /* Parsing from a decimal string.                   */
+        to_string,  /* Printing into a decimal string.                  */
+    };
+
+    /* Number of kinds of kernels. */
+    inline static constexpr std::size_t Kernels = 7;
+    /**
+     * Number of buckets of the histograms. Bucket i counts operands of
+     * [2^(i - 1), 2^i) words (bucket 0 for 0 word), and the last one
+     * also counts all the longer operands.
+     */
+    inline static constexpr std::size_t Buckets = 32;
+    /* Live bytes kept by one thread before moved to the shared counter. */
+    inline static constexpr std::ptrdiff_t Flush_Bytes = std::ptrdiff_t {1} << 14;
+    /* Whether the counters are compiled in. */
+#ifdef _DARK_NO_STATS
+    inline static constexpr bool enabled = false;
+#else
+    inline static constexpr bool enabled = true;
+#endif
+
+    /* Calls of one kernel, by the size of its longest operand. */
+    struct kernel_t {
+        std::size_t calls;
+        std::size_t words;              /* Sum of the sizes of operands. */
+        std::size_t histogram[Buckets];
+    };
+
+    /* Values of all the counters at one time. */
+    struct snapshot_t {
+        std::size_t alloc_bytes;        /* Bytes allocated from the heap.       */
+        std::size_t alloc_count;        /* Blocks allocated from the heap.      */
+        std::size_t freed_bytes;        /* Bytes given back to the heap.        */
+        std::size_t freed_count;        /* Blocks given back to the heap.       */
+        std::size_t live_bytes;         /* Bytes allocated but not freed yet.   */
+        std::size_t peak_bytes;         /* Most live bytes at the same time.    */
+        std::size_t fft_checked;        /* FFT products checked by the guard.   */
+        std::size_t fft_fallback;       /* Those failing, recomputed by NTT.    */
+        kernel_t    kernels[Kernels];   /* Indexed by kernel.                   */
+
+        const kernel_t &operator[](kernel __k) const noexcept {
+            return kernels[static_cast <std::size_t> (__k)];
+        }
+    };
+
+  protected:
+    using counter = std::atomic <std::size_t>;
+
+    /**
+     * Counters of one thread. Only the owner writes, and anyone may read.
+     * The retired block is the only one written by many threads.
+     */
+    struct block_t {
+        counter alloc_bytes;
+        counter alloc_count;
+        counter freed_bytes;
+        counter freed_count;
+        counter fft_checked;
+        counter fft_fallback;
+        counter calls[Kernels];
+        counter words[Kernels];
+        counter histogram[Kernels][Buckets];
+        block_t *prev;
+        block_t *next;
+        std::ptrdiff_t pending; /* Live bytes not moved to the shared counter. */
+    };
+
+    /* Register the block of a thread, and retire it at thread exit. */
+    struct holder_t {
+        block_t block {};
+        holder_t() noexcept;
+        ~holder_t() noexcept;
+    };
+
+    inline static std::mutex lock {};
+    inline static block_t *head = nullptr;      /* Blocks of the living threads.    */
+    inline static block_t  retired {};          /* Sum of the exited threads.       */
+    inline static std::atomic <std::ptrdiff_t> live_bytes {0};
+    inline static counter  peak_bytes {0};
+
+    /* Block of the calling thread, which is null before the first count. */
+    inline static thread_local constinit block_t *current = nullptr;
+    /* Whether the block of the calling thread is retired. */
+    inline static thread_local constinit bool closed = false;
+
+    /* Add to a counter, which needs no atomic read-modify-write if it is not shared. */
+    static void add(const block_t &__block, counter &__cnt, std::size_t __n) noexcept {
+        if (&__block == &retired) __cnt.fetch_add(__n, std::memory_order_relaxed);
+        else __cnt.store(__cnt.load(std::memory_order_relaxed) + __n, std::memory_order_relaxed);
+    }
+
+    /* Move __n live bytes to the shared counter, and update the peak. */
+    static void flush(std::ptrdiff_t __n) noexcept {
+        const std::ptrdiff_t __live = live_bytes.fetch_add(__n, std::memory_order_relaxed) + __n;
+        if (__live <= 0) return;
+        std::size_t __peak = peak_bytes.load(std::memory_order_relaxed);
+        while (__peak < static_cast <std::size_t> (__live) &&
+            !peak_bytes.compare_exchange_weak(__peak, __live, std::memory_order_relaxed));
+    }
+
+    /* Keep __n more (or less) live bytes in the block of the calling thread. */
+    static void keep(block_t &__block, std::ptrdiff_t __n) noexcept {
+        if (&__block == &retired) return flush(__n);
+        __block.pending += __n;
+        if (__block.pending >= Flush_Bytes || __block.pending <= -Flush_Bytes)
+            flush(std::exchange(__block.pending, 0));
+    }
+
+    static void merge(snapshot_t &, const block_t &) noexcept;
+    static block_t &attach() noexcept;
+
+    /* Block to count in for the calling thread. */
+    static block_t &local() noexcept {
+        block_t *const __ptr = current;
+        return __ptr != nullptr ? *__ptr : attach();
+    }
+
+    /* Bucket of an operand of __n words. */
+    static std::size_t bucket_of(std::size_t __n) noexcept {
+        return std::min <std::size_t> (std::bit_width(__n), Buckets - 1);
+    }
+
+  public:
+#ifdef _DARK_NO_STATS
+    static void on_alloc(std::size_t) noexcept {}
+    static void on_free(std::size_t) noexcept {}
+    static void on_call(kernel, std::size_t) noexcept {}
+    static void on_guard(bool) noexcept {}
+#else
+    /* Count a block of __n bytes allocated from the heap. */
+    static void on_alloc(std::size_t __n) noexcept {
+        block_t &__block = local();
+        add(__block, __block.alloc_bytes, __n);
+        add(__block, __block.alloc_count, 1);
+        keep(__block, static_cast <std::ptrdiff_t> (__n));
+    }
+
+    /* Count a block of __n bytes given back to the heap. */
+    static void on_free(std::size_t __n) noexcept {
+        block_t &__block = local();
+        add(__block, __block.freed_bytes, __n);
+        add(__block, __block.freed_count, 1);
+        keep(__block, -static_cast <std::ptrdiff_t> (__n));
+    }
+
+    /* Count a call of kernel __k, whose longest operand has __n words. */
+    static void on_call(kernel __k, std::size_t __n) noexcept {
+        block_t &__block = local();
+        const auto __i = static_cast <std::size_t> (__k);
+        add(__block, __block.calls[__i], 1);
+        add(__block, __block.words[__i], __n);
+        add(__block, __block.histogram[__i][bucket_of(__n)], 1);
+    }
+
+    /* Count a FFT product checked by the precision guard, and whether it failed. */
+    static void on_guard(bool __failed) noexcept {
+        block_t &__block = local();
+        add(__block, __block.fft_checked, 1);
+        if (__failed) add(__block, __block.fft_fallback, 1);
+    }
+#endif
+
+    static snapshot_t snapshot() noexcept;
+};
+
+#ifndef _DARK_NO_STATS
+
+/* Link the block into the list of living threads. */
+inline int2048_stats::holder_t::holder_t() noexcept {
+    std::lock_guard __guard {lock};
+    block.next = head;
+    if (head != nullptr) head->prev = &block;
+    head = &block;
+}
+
+/* Add the block to the retired one, and unlink it. */
+inline int2048_stats::holder_t::~holder_t() noexcept {
+    flush(std::exchange(block.pending, 0));
+    std::lock_guard __guard {lock};
+    const auto __move = [](counter &__dst, const counter &__src) {
+        __dst.fetch_add(__src.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    };
+    __move(retired.alloc_bytes, block.alloc_bytes);
+    __move(retired.alloc_count, block.alloc_count);
+    __move(retired.freed_bytes, block.freed_bytes);
+    __move(retired.freed_count, block.freed_count);
+    __move(retired.fft_checked, block.fft_checked);
+    __move(retired.fft_fallback, block.fft_fallback);
+    for (std::size_t i = 0 ; i != Kernels ; ++i) {
+        __move(retired.calls[i], block.calls[i]);
+        __move(retired.words[i], block.words[i]);
+        for (std::size_t j = 0 ; j != Buckets ; ++j)
+            __move(retired.histogram[i][j], block.histogram[i][j]);
+    }
+
+    if (block.prev != nullptr) block.prev->next = block.next;
+    else                       head = block.next;
+    if (block.next != nullptr) block.next->prev = block.prev;
+    current = nullptr;
+    closed  = true;
+}
+
+/**
+ * @brief Set up the block of the calling thread on its first count.
+ * After the thread has retired its block (at thread exit), the counts
+ * go to the retired block directly.
+ */
+inline auto int2048_stats::attach() noexcept -> block_t & {
+    if (closed) return retired;
+    static thread_local holder_t __holder;
+    return *(current = &__holder.block);
+}
+
+#endif
+
+/* Add the counters of a block to the snapshot. */
+inline void int2048_stats::merge(snapshot_t &__snap, const block_t &__block) noexcept {
+    const auto __get = [](const counter &__cnt) { return __cnt.load(std::memory_order_relaxed); };
+    __snap.alloc_bytes += __get(__block.alloc_bytes);
+    __snap.alloc_count += __get(__block.alloc_count);
+    __snap.freed_bytes += __get(__block.freed_bytes);
+    __snap.freed_count += __get(__block.freed_count);
+    __snap.fft_checked += __get(__block.fft_checked);
+    __snap.fft_fallback += __get(__block.fft_fallback);
+    for (std::size_t i = 0 ; i != Kernels ; ++i) {
+        __snap.kernels[i].calls += __get(__block.calls[i]);
+        __snap.kernels[i].words += __get(__block.words[i]);
+        for (std::size_t j = 0 ; j != Buckets ; ++j)
+            __snap.kernels[i].histogram[j] += __get(__block.histogram[i][j]);
+    }
+}
+
+/**
+ * @brief Return the values of all the counters, summed over all the threads.
+ * @note Counts from other threads at the same time may be partly included.
+ */
+inline auto int2048_stats::snapshot() noexcept -> snapshot_t {
+    snapshot_t __snap {};
+#ifndef _DARK_NO_STATS
+    std::lock_guard __guard {lock};
+    merge(__snap, retired);
+    for (const block_t *__ptr = head ; __ptr != nullptr ; __ptr = __ptr->next)
+        merge(__snap, *__ptr);
+    __snap.live_bytes = __snap.alloc_bytes - __snap.freed_bytes;
+    __snap.peak_bytes = std::max(peak_bytes.load(std::memory_order_relaxed), __snap.live_bytes);
+#endif
+    return __snap;
+}
+
+} // namespace dark
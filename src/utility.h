@@ -3,15 +3,27 @@
 #include "memory.h"
 #include <bit>
 #include <cstring>
+#include <atomic>
 #include <concepts>
+#include <algorithm>
 
 namespace dark::int2048_helper {
 
+/* Inline storage of a vector. */
+template <typename _Tp, std::size_t _Inline>
+struct small_buffer { _Tp data[_Inline]; };
+
+/* No inline storage at all. */
+template <typename _Tp>
+struct small_buffer <_Tp, 0> { inline static constexpr _Tp *data = nullptr; };
+
 /**
  * @brief A simple yet fast vector implementation
  * for int2048 to use.
+ * @tparam _Inline Number of elements that can be stored inside
+ * the vector itself. The heap is used only for larger capacity.
  */
-template <typename _Tp>
+template <typename _Tp, std::size_t _Inline = 0>
 struct vector {
   protected:
     using _Alloc    = dark::allocator <_Tp>;
@@ -20,11 +32,23 @@ struct vector {
     _Tp *head;
     _Tp *tail;
     _Tp *term;
+    [[no_unique_address]] small_buffer <_Tp, _Inline> local;
+
+    /* Whether the elements are stored inside the vector itself. */
+    bool is_local() const noexcept { return _Inline != 0 && head == local.data; }
 
-    /* Steal the data from rhs and reset rhs. */
+    /**
+     * @brief Steal the data from rhs and reset rhs.
+     * Inline elements are copied, as they cannot be stolen.
+     */
     void steal(vector &rhs) noexcept {
-        head = rhs.head, tail = rhs.tail, term = rhs.term;
-        // std::memcpy(this, &rhs, sizeof(vector));
+        if (rhs.is_local()) {
+            std::memcpy(local.data, rhs.head, rhs.size() * sizeof(_Tp));
+            tail = local.data + rhs.size();
+            term = (head = local.data) + _Inline;
+        } else {
+            head = rhs.head, tail = rhs.tail, term = rhs.term;
+        }
         return rhs.reset();
     }
 
@@ -36,7 +60,7 @@ struct vector {
 
     /* Deallocate the memory inside. */
     void deallocate() noexcept {
-        alloc.deallocate(head, this->capacity());
+        if (!this->is_local()) alloc.deallocate(head, this->capacity());
     }
 
   public:
@@ -47,12 +71,12 @@ struct vector {
     ~vector() noexcept { this->deallocate(); }
 
     vector (const _Tp *__beg, const _Tp *__end) : vector(__end - __beg) {
-        tail = term;
+        this->resize(__end - __beg);
         std::memcpy(head, __beg, this->size() * sizeof(_Tp));
     }
 
     /* Reserve __n space for the vector. */
-    vector(std::size_t __n) : head(alloc.allocate(__n)), tail(head), term(head + __n) {}
+    vector(std::size_t __n) : vector() { this->init_capacity(__n); }
 
     vector(const vector &rhs) : vector(rhs.size())  {
         this->resize(rhs.size());
@@ -83,20 +107,33 @@ struct vector {
      * @param __n The capacity of the vector.
      */
     void init_capacity(std::size_t __n) {
-        tail = head = alloc.allocate(__n);
-        term = head + __n;
+        if (_Inline != 0 && __n <= _Inline) {
+            tail = head = local.data;
+            term = head + _Inline;
+        } else {
+            tail = head = alloc.allocate(__n);
+            term = head + __n;
+        }
     }
 
     /**
      * @brief Force to set the capacity of the vector.
      * @param __n The new capacity of the vector.
      * @note __n should be no less than the size of the vector.
+     * If __n fits inline, the capacity will be exactly _Inline.
      */
     void set_capacity(std::size_t __n) {
-        _Tp *const __next = alloc.allocate(__n);
-        std::memcpy(__next, head, this->size() * sizeof(_Tp));
+        const std::size_t __size = this->size();
+        _Tp *__next;
+        if (_Inline != 0 && __n <= _Inline) {
+            if (this->is_local()) return;
+            __next = local.data, __n = _Inline;
+        } else {
+            __next = alloc.allocate(__n);
+        }
+        std::memcpy(__next, head, __size * sizeof(_Tp));
         this->deallocate();
-        tail = __next + this->size();
+        tail = __next + __size;
         term = (head = __next) + __n;
     }
 
@@ -157,8 +194,14 @@ struct vector {
         if (this->vacancy() != 0) this->set_capacity(this->size());
     }
 
-    /* Swap the content. */
+    /* Swap the content. Inline elements are copied. */
     void swap(vector &rhs) noexcept {
+        if (this->is_local() || rhs.is_local()) {
+            vector __tmp;
+            __tmp.steal(*this);
+            this->steal(rhs);
+            return rhs.steal(__tmp);
+        }
         std::swap(head, rhs.head);
         std::swap(tail, rhs.tail);
         std::swap(term, rhs.term);
@@ -199,16 +242,209 @@ struct vector {
 namespace std {
 
 /* Overload of std::swap vector */
-template <typename _Tp>
+template <typename _Tp, std::size_t _Inline>
 void swap
-    (dark::int2048_helper::vector <_Tp> &__lhs,
-     dark::int2048_helper::vector <_Tp> &__rhs)
+    (dark::int2048_helper::vector <_Tp, _Inline> &__lhs,
+     dark::int2048_helper::vector <_Tp, _Inline> &__rhs)
 noexcept { __lhs.swap(__rhs); }
 
 }
 
 namespace dark::int2048_helper {
 
+/**
+ * @brief Per-thread stack of scratch memory for the temporaries of the
+ * kernels, which are borrowed and given back in LIFO order (see scratch).
+ * The memory grows to the high-water mark of the thread and is reused,
+ * so a loop of operations of the same size does no heap allocation after
+ * the first one. Blocks which do not fit are taken from the heap, and the
+ * memory grows to the mark once nothing is borrowed.
+ */
+struct scratch_arena {
+    /* Alignment of each block. */
+    inline static constexpr std::size_t Align = alignof(std::max_align_t);
+    /* Default cap of the memory kept by one thread, in bytes. */
+    inline static constexpr std::size_t Default_Limit = std::size_t {1} << 26;
+    /* Mark of a block which is taken from the heap. */
+    inline static constexpr std::size_t Heap_Mark = std::size_t (-1);
+
+    /* Usage of the arena of one thread. */
+    struct usage_t {
+        std::size_t reserved;   /* Bytes of the memory kept.                */
+        std::size_t in_use;     /* Bytes borrowed now, including the heap.  */
+        std::size_t peak;       /* Most bytes borrowed at the same time.    */
+        std::size_t spills;     /* Blocks which are taken from the heap.    */
+    };
+
+  protected:
+    struct state_t {
+        std::byte   *data;
+        std::size_t  size;      /* Bytes of the memory.                     */
+        std::size_t  top;       /* Bytes borrowed from the memory.          */
+        std::size_t  depth;     /* Bytes borrowed, including the heap.      */
+        std::size_t  peak;
+        std::size_t  spills;
+        bool         drop;      /* Whether to release once nothing is borrowed. */
+        bool         owned;     /* Whether the guard of the thread is set.  */
+        bool         closed;    /* Whether the thread is exiting.           */
+    };
+
+    /* Release the memory at thread exit. */
+    struct guard_t {
+        ~guard_t() noexcept {
+            if (state.data != nullptr) int2048_stats::on_free(state.size);
+            ::dark::free(state.data);
+            state = {};
+            state.closed = true;
+        }
+    };
+
+    inline static thread_local constinit state_t state {};
+    inline static std::atomic <std::size_t> limit_bytes {Default_Limit};
+
+    /* Resize the memory to the mark (or release it) when nothing is borrowed. */
+    static void settle(state_t &__state) {
+        const std::size_t __cap  = limit_bytes.load(std::memory_order_relaxed);
+        const std::size_t __want = __state.drop ? 0 : std::min(__state.peak, __cap);
+        if (!__state.drop && __want <= __state.size && __state.size <= __cap) return;
+
+        if (__state.data != nullptr) int2048_stats::on_free(__state.size);
+        ::dark::free(std::exchange(__state.data, nullptr));
+        __state.size = 0;
+        if (__state.drop) __state.peak = 0;
+        __state.drop = false;
+        if (__want == 0 || __state.closed) return;
+
+        __state.data = static_cast <std::byte *> (::dark::malloc(__want));
+        if (__state.data == nullptr) return;
+        int2048_stats::on_alloc(__want);
+        __state.size = __want;
+        if (!__state.owned) {
+            [[maybe_unused]] static thread_local guard_t __guard;
+            __state.owned = true;
+        }
+    }
+
+  public:
+    /**
+     * @brief Borrow a block of __n bytes (rounded up to Align).
+     * @param __mark Output of the mark, used to give the block back.
+     */
+    static void *borrow(std::size_t __n, std::size_t &__mark) {
+        state_t &__state = state;
+        __n = (__n + (Align - 1)) & ~(Align - 1);
+        __state.depth += __n;
+        __state.peak   = std::max(__state.peak, __state.depth);
+        if (__state.size - __state.top >= __n) {
+            __mark = __state.top;
+            __state.top += __n;
+            return __state.data + __mark;
+        }
+        ++__state.spills;
+        __mark = Heap_Mark;
+        int2048_stats::on_alloc(__n);
+        return ::dark::malloc(__n);
+    }
+
+    /**
+     * @brief Give back a block of __n bytes with its mark.
+     * @note Blocks should be given back in the reverse order of borrowing.
+     */
+    static void give_back(void *__ptr, std::size_t __n, std::size_t __mark) noexcept {
+        state_t &__state = state;
+        __n = (__n + (Align - 1)) & ~(Align - 1);
+        __state.depth -= __n;
+        if (__mark == Heap_Mark) {
+            int2048_stats::on_free(__n);
+            ::dark::free(__ptr);
+        } else {
+#ifdef _DARK_DEBUG
+            /* This runs in destructors, so report and abort instead of throwing. */
+            if (__mark + __n != __state.top) {
+                error("Scratch is not given back in order!");
+                std::abort();
+            }
+#endif
+            __state.top = __mark;
+        }
+        if (__state.depth == 0) settle(__state);
+    }
+
+    /**
+     * @brief Set the cap of the memory kept by each thread, in bytes.
+     * Blocks beyond the cap are still available, but taken from the heap.
+     */
+    static void set_limit(std::size_t __n) noexcept {
+        limit_bytes.store(__n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Release the memory of the calling thread and reset its mark.
+     * If something is borrowed, it is done once all is given back.
+     */
+    static void release() noexcept {
+        state_t &__state = state;
+        __state.drop = true;
+        if (__state.depth == 0) settle(__state);
+    }
+
+    /* Return the usage of the arena of the calling thread. */
+    static usage_t usage() noexcept {
+        const state_t &__state = state;
+        return { __state.size, __state.depth, __state.peak, __state.spills };
+    }
+};
+
+/**
+ * @brief A block of scratch memory of trivial elements,
+ * borrowed from scratch_arena and given back on destruction.
+ * @note It should be used as a local variable only, so that
+ * blocks are always given back in the reverse order.
+ */
+template <typename _Tp>
+struct scratch {
+  protected:
+    static_assert(std::is_trivially_copyable_v <_Tp>);
+    _Tp        *head;
+    _Tp        *term;
+    std::size_t mark;
+
+  public:
+    using iterator          = _Tp *;
+    using const_iterator    = const _Tp *;
+
+    scratch() noexcept : head(), term(), mark() {}
+    explicit scratch(std::size_t __n) : scratch() { this->init_capacity(__n); }
+
+    scratch(const scratch &) = delete;
+    scratch &operator = (const scratch &) = delete;
+
+    ~scratch() noexcept {
+        if (head != term) scratch_arena::give_back(head, this->capacity() * sizeof(_Tp), mark);
+    }
+
+    /**
+     * @brief Borrow __n elements.
+     * @note It should be called only once, and before any later block is borrowed.
+     */
+    void init_capacity(std::size_t __n) {
+        if (__n == 0) return;
+        head = static_cast <_Tp *> (scratch_arena::borrow(__n * sizeof(_Tp), mark));
+        term = head + __n;
+    }
+
+    _Tp &operator[](std::size_t __n) noexcept { return head[__n]; }
+    const _Tp &operator[](std::size_t __n) const noexcept { return head[__n]; }
+
+    std::size_t capacity() const noexcept { return term - head; }
+
+    iterator begin()    noexcept { return head; }
+    iterator end()      noexcept { return term; }
+
+    const_iterator begin()  const noexcept { return head; }
+    const_iterator end()    const noexcept { return term; }
+};
+
 /* Constexpr pow function. */
 template <std::unsigned_integral _Tp>
 inline constexpr _Tp __pow(_Tp __x, std::size_t __y) {
@@ -0,0 +1,96 @@
+/**
+ * @brief Check of division and mod by builtin integers of both signs,
+ * against division by the same divisor as an int2048.
+ * Both round the quotient down, and the remainder has the same sign as
+ * the divisor. Narrow signed types are included, since their negative
+ * values must be sign-extended before negated.
+ *
+ * Build and run (exits with 1 on any mismatch):
+ *  g++ -std=c++20 -O2 -I../src div_small.cpp -o div_small -pthread
+ *  ./div_small
+ */
+#include "int2048"
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+
+using dark::int2048;
+
+namespace {
+
+std::mt19937_64 gen {2048};
+int failures = 0;
+
+/* Random number of __n decimal digits, without leading 0. */
+std::string random_digits(std::size_t __n) {
+    std::string __str;
+    __str.push_back('1' + gen() % 9);
+    while (__str.size() < __n) __str.push_back('0' + gen() % 10);
+    return __str;
+}
+
+void expect(bool __ok, const char *__what, const int2048 &__lhs, long long __val) {
+    if (__ok) return;
+    if (failures++ < 10)
+        std::printf("%s failed: %s by %lld\n", __what, __lhs.to_string().c_str(), __val);
+}
+
+/* Compare all the ways to divide __lhs by __val with the int2048 divisor. */
+template <typename _Tp>
+void check(const int2048 &__lhs, _Tp __val) {
+    const int2048 __den {static_cast <std::intmax_t> (__val)};
+    const int2048 __quo = __lhs / __den;
+    const int2048 __rem = __lhs % __den;
+    const int2048 __rem_small {static_cast <std::intmax_t> (__lhs % __val)};
+
+    int2048 __div_eq = __lhs;
+    __div_eq /= __val;
+    int2048 __mod_eq = __lhs;
+    __mod_eq %= __val;
+    int2048 __both = __lhs;
+    const int2048 __rest {static_cast <std::intmax_t> (__both.divmod(__val))};
+
+    const long long __v = static_cast <long long> (__val);
+    expect(__lhs / __val == __quo, "operator /", __lhs, __v);
+    expect(__rem_small == __rem, "operator %", __lhs, __v);
+    expect(__div_eq == __quo, "operator /=", __lhs, __v);
+    expect(__mod_eq == __rem, "operator %=", __lhs, __v);
+    expect(__both == __quo && __rest == __rem, "divmod", __lhs, __v);
+}
+
+template <typename _Tp>
+void check_type(const int2048 &__lhs) {
+    for (const long long __v : {1LL, 3LL, 7LL, 10LL, 127LL})
+        check(__lhs, static_cast <_Tp> (__v)), check(__lhs, static_cast <_Tp> (-__v));
+    check(__lhs, static_cast <_Tp> (std::numeric_limits <_Tp>::max()));
+    if constexpr (std::is_signed_v <_Tp>)
+        check(__lhs, static_cast <_Tp> (std::numeric_limits <_Tp>::min()));
+    for (int i = 0 ; i != 20 ; ++i) {
+        const auto __v = static_cast <_Tp> (gen());
+        if (__v != 0) check(__lhs, __v);
+    }
+}
+
+} // namespace
+
+int main() {
+    /* The examples from the bug report. */
+    const int2048 __hundred {std::intmax_t {100}};
+    expect(__hundred / -7 == int2048 {std::intmax_t {-15}}, "100 / -7", __hundred, -7);
+    expect(__hundred % -7 == -5, "100 % -7", __hundred, -7);
+    expect(__hundred % short {-3} == short {-2}, "100 % short(-3)", __hundred, -3);
+
+    for (const std::size_t __n : {1, 2, 9, 17, 40, 300}) {
+        for (const bool __negative : {false, true}) {
+            const int2048 __lhs {(__negative ? "-" : "") + random_digits(__n)};
+            check_type <short> (__lhs);
+            check_type <int> (__lhs);
+            check_type <long long> (__lhs);
+            check_type <unsigned> (__lhs);
+        }
+    }
+
+    std::puts(failures ? "FAILED" : "ok");
+    return failures != 0;
+}